@@ -0,0 +1,156 @@
+#include "AllocationTracker.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+namespace
+{
+	// Plain counters, so that they can be used before any constructor runs.
+	thread_local uint64_t threadAllocations = 0;
+	thread_local uint64_t threadBytes = 0;
+
+	std::atomic<uint64_t> totalAllocations(0);
+	std::atomic<uint64_t> totalBytes(0);
+}
+
+AllocationCounts AllocationCounts::operator-(const AllocationCounts& other) const
+{
+	AllocationCounts difference;
+	difference.allocations = allocations - other.allocations;
+	difference.bytes = bytes - other.bytes;
+
+	return difference;
+}
+
+bool AllocationTracker::IsEnabled()
+{
+#ifdef GESTURE_TRACK_ALLOCATIONS
+	return true;
+#else
+	return false;
+#endif
+}
+
+AllocationCounts AllocationTracker::GetThreadCounts()
+{
+	AllocationCounts counts;
+	counts.allocations = threadAllocations;
+	counts.bytes = threadBytes;
+
+	return counts;
+}
+
+AllocationCounts AllocationTracker::GetTotal()
+{
+	AllocationCounts counts;
+	counts.allocations = totalAllocations.load(std::memory_order_relaxed);
+	counts.bytes = totalBytes.load(std::memory_order_relaxed);
+
+	return counts;
+}
+
+void AllocationTracker::Record(std::size_t size)
+{
+	++threadAllocations;
+	threadBytes += size;
+
+	totalAllocations.fetch_add(1, std::memory_order_relaxed);
+	totalBytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+#ifdef GESTURE_TRACK_ALLOCATIONS
+// Replace the global operator new and delete. The nothrow versions call these ones.
+// The aligned versions are replaced too, since std::pmr::new_delete_resource may use them.
+void* operator new(std::size_t size)
+{
+	AllocationTracker::Record(size);
+
+	if (size == 0)
+		size = 1;
+
+	void* memory = std::malloc(size);
+	if (memory == nullptr)
+		throw std::bad_alloc();
+
+	return memory;
+}
+
+void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	AllocationTracker::Record(size);
+
+	// aligned_alloc needs a size that is a multiple of the alignment.
+	const std::size_t alignmentSize = (std::size_t)alignment;
+	size = (size + alignmentSize - 1) / alignmentSize * alignmentSize;
+	if (size == 0)
+		size = alignmentSize;
+
+#ifdef _MSC_VER
+	void* memory = _aligned_malloc(size, alignmentSize);
+#else
+	void* memory = std::aligned_alloc(alignmentSize, size);
+#endif
+	if (memory == nullptr)
+		throw std::bad_alloc();
+
+	return memory;
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+	return operator new(size, alignment);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept
+{
+#ifdef _MSC_VER
+	_aligned_free(memory);
+#else
+	std::free(memory);
+#endif
+}
+
+void operator delete[](void* memory, std::align_val_t alignment) noexcept
+{
+	operator delete(memory, alignment);
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t alignment) noexcept
+{
+	operator delete(memory, alignment);
+}
+
+void operator delete[](void* memory, std::size_t, std::align_val_t alignment) noexcept
+{
+	operator delete(memory, alignment);
+}
+#endif
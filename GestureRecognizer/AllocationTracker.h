@@ -0,0 +1,34 @@
+// AllocationTracker.h
+// Programmer: Khoi Ho
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// The number of heap allocations and the number of bytes allocated.
+struct AllocationCounts
+{
+	uint64_t allocations = 0;
+	uint64_t bytes = 0;
+
+	AllocationCounts operator- (const AllocationCounts& other) const;
+};
+
+// Counts the allocations made through the global operator new, so that the allocations of the recognition can be checked.
+// The global operator new and delete are only replaced when GESTURE_TRACK_ALLOCATIONS is defined. Otherwise, nothing is counted.
+class AllocationTracker
+{
+public:
+	// Returns true if the allocations are counted.
+	static bool IsEnabled();
+
+	// Returns the allocations made by the calling thread since it started.
+	static AllocationCounts GetThreadCounts();
+
+	// Returns the allocations made by all threads since the program started.
+	static AllocationCounts GetTotal();
+
+	// Counts an allocation on the calling thread.
+	static void Record(std::size_t size);
+};
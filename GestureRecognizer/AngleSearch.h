@@ -0,0 +1,125 @@
+// AngleSearch.h
+// Programmer: Khoi Ho
+
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include "Kernels.h"
+#include "WorkCounters.h"
+
+// The range and the precision of the search for the best angle, as in the $1 paper.
+const float ANGLE_SEARCH_PI = 2.0f * std::acos(0.0f);
+const float ANGLE_ALPHA = -0.25f * ANGLE_SEARCH_PI; // -45 degrees.
+const float ANGLE_BETA = 0.25f * ANGLE_SEARCH_PI;   //  45 degrees.
+const float ANGLE_DELTA = ANGLE_SEARCH_PI / 90.0f;  //   2 degrees.
+
+// Finds the minimum of distanceAtProbe(angle, probe) between angleAlpha and angleBeta using the golden-section search, as in Stroke::GetDistanceAtBestAngle.
+// Each probe is numbered by its place in the tree of all the possible searches: bracket 1 is [angleAlpha, angleBeta], the probes inside bracket b are 2b and 2b + 1,
+// and the next bracket is 2b if the left probe is better, or 2b + 1 otherwise. So a probe number always stands for the same angle, whatever the distance function.
+template <typename DistanceAtProbe>
+float SearchBestAngleByProbe(DistanceAtProbe distanceAtProbe, float angleAlpha, float angleBeta, float angleDelta)
+{
+	static const float phi = 0.5f * (-1.0f + std::sqrt(5.0f));
+
+	WorkCounters& workCounters = WorkCounters::GetThreadCounters();
+
+	int bracket = 1;
+
+	float x1 = phi * angleAlpha + (1.0f - phi) * angleBeta;
+	float f1 = distanceAtProbe(x1, 2 * bracket);
+
+	float x2 = (1.0f - phi) * angleAlpha + phi * angleBeta;
+	float f2 = distanceAtProbe(x2, 2 * bracket + 1);
+
+	workCounters.distanceEvaluations += 2;
+
+	while (std::abs(angleBeta - angleAlpha) > angleDelta)
+	{
+		++workCounters.angleSearchIterations;
+		++workCounters.distanceEvaluations;
+
+		if (f1 < f2)
+		{
+			bracket = 2 * bracket;
+			angleBeta = x2;
+			x2 = x1;
+			f2 = f1;
+			x1 = phi * angleAlpha + (1.0f - phi) * angleBeta;
+			f1 = distanceAtProbe(x1, 2 * bracket);
+		}
+		else
+		{
+			bracket = 2 * bracket + 1;
+			angleAlpha = x1;
+			x1 = x2;
+			f1 = f2;
+			x2 = (1.0f - phi) * angleAlpha + phi * angleBeta;
+			f2 = distanceAtProbe(x2, 2 * bracket + 1);
+		}
+	}
+
+	return f1 < f2 ? f1 : f2;
+}
+
+// Finds the minimum of distanceAtAngle(angle) between angleAlpha and angleBeta using the golden-section search.
+template <typename DistanceAtAngle>
+float SearchBestAngle(DistanceAtAngle distanceAtAngle, float angleAlpha, float angleBeta, float angleDelta)
+{
+	return SearchBestAngleByProbe([&](float angle, int) { return distanceAtAngle(angle); }, angleAlpha, angleBeta, angleDelta);
+}
+
+// Finds the minimum of distancesAtAngles(angles, distances) between angleAlpha and angleBeta, which evaluates ANGLE_LANES angles at once.
+// The angles split the bracket evenly and the next bracket lies between the neighbors of the best angle, so the bracket shrinks by 2 / (ANGLE_LANES + 1) at each step
+// instead of 0.618, and the search takes half as many dependent steps as the golden-section search.
+template <typename DistancesAtAngles>
+float SearchBestAngleInParallel(DistancesAtAngles distancesAtAngles, float angleAlpha, float angleBeta, float angleDelta)
+{
+	WorkCounters& workCounters = WorkCounters::GetThreadCounters();
+
+	float angles[ANGLE_LANES];
+	float distances[ANGLE_LANES];
+	float bestDistance = std::numeric_limits<float>::infinity();
+
+	float bracketWidth;
+	do
+	{
+		const float step = (angleBeta - angleAlpha) / (ANGLE_LANES + 1);
+		for (int k = 0; k < ANGLE_LANES; ++k)
+			angles[k] = angleAlpha + (k + 1) * step;
+
+		distancesAtAngles(angles, distances);
+
+		++workCounters.angleSearchIterations;
+		workCounters.distanceEvaluations += ANGLE_LANES;
+
+		int best = 0;
+		for (int k = 1; k < ANGLE_LANES; ++k)
+		{
+			if (distances[k] < distances[best])
+				best = k;
+		}
+
+		if (distances[best] < bestDistance)
+			bestDistance = distances[best];
+
+		angleAlpha = angles[best] - step;
+		angleBeta = angles[best] + step;
+		bracketWidth = 2.0f * step;
+	} while (bracketWidth > angleDelta);
+
+	return bestDistance;
+}
+
+// Returns an upper bound of the probe numbers of SearchBestAngleByProbe.
+inline int GetAngleSearchProbeCount(float angleAlpha, float angleBeta, float angleDelta)
+{
+	static const float phi = 0.5f * (-1.0f + std::sqrt(5.0f));
+
+	// The bracket shrinks by phi at each iteration. Allow one more iteration in case of rounding errors.
+	int iterationCount = 1;
+	for (float width = std::abs(angleBeta - angleAlpha); width > angleDelta; width *= phi)
+		++iterationCount;
+
+	return 1 << (iterationCount + 2);
+}
@@ -0,0 +1,45 @@
+#include "BatchNormalization.h"
+#include <algorithm>
+#include <vector>
+#include "Kernels.h"
+#include "StrokePipeline.h"
+
+void NormalizeStrokes(const Stroke* strokes, int strokeCount, int pointCount, int size, float* xs, float* ys)
+{
+	std::vector<Vector2> resampledPoints(pointCount);
+	std::vector<float> blockX(pointCount * STROKE_LANES);
+	std::vector<float> blockY(pointCount * STROKE_LANES);
+
+	for (int first = 0; first < strokeCount; first += STROKE_LANES)
+	{
+		const int laneCount = std::min(STROKE_LANES, strokeCount - first);
+
+		// The resampling walks each stroke sequentially, so it is the only step done one stroke at a time.
+		// The lanes after the last stroke are padded with copies of it.
+		for (int k = 0; k < STROKE_LANES; ++k)
+		{
+			if (k < laneCount)
+				ResamplePoints(strokes[first + k], pointCount, resampledPoints.data());
+
+			for (int i = 0; i < pointCount; ++i)
+			{
+				blockX[i * STROKE_LANES + k] = resampledPoints[i].x;
+				blockY[i * STROKE_LANES + k] = resampledPoints[i].y;
+			}
+		}
+
+		NormalizeInterleavedStrokes(blockX.data(), blockY.data(), pointCount, size);
+
+		for (int k = 0; k < laneCount; ++k)
+		{
+			float* x = xs + (first + k) * pointCount;
+			float* y = ys + (first + k) * pointCount;
+
+			for (int i = 0; i < pointCount; ++i)
+			{
+				x[i] = blockX[i * STROKE_LANES + k];
+				y[i] = blockY[i * STROKE_LANES + k];
+			}
+		}
+	}
+}
@@ -0,0 +1,11 @@
+// BatchNormalization.h
+// Programmer: Khoi Ho
+
+#pragma once
+
+#include "Stroke.h"
+
+// Normalizes the strokes as Stroke::Normalize, with the same results, and writes the points of stroke i to xs[i * pointCount] to xs[(i + 1) * pointCount - 1],
+// and likewise for the y coordinates, as in TemplateBank. The strokes are resampled one at a time into blocks of STROKE_LANES interleaved strokes,
+// then the rotation, the scaling, the translation and the centroid and bounding box reductions run on a whole block at once with NormalizeInterleavedStrokes.
+void NormalizeStrokes(const Stroke* strokes, int strokeCount, int pointCount, int size, float* xs, float* ys);
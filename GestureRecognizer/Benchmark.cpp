@@ -0,0 +1,697 @@
+#include "Benchmark.h"
+#include "AllocationTracker.h"
+#include "BatchNormalization.h"
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include "Kernels.h"
+#include "LshIndex.h"
+#include "PerfCounters.h"
+#include "Profiler.h"
+#include "QuantizedTemplateBank.h"
+#include "Random.h"
+#include "StrokePipeline.h"
+#include "TemplateBank.h"
+#include "VantagePointTree.h"
+#include "WorkCounters.h"
+
+namespace
+{
+	const int QUERIES_PER_STROKE = 2;
+	const int SIZE = 250;
+	const unsigned int SEED = 12345;
+	const int ARENA_SIZE = 1024 * 1024;
+
+	// The templates are preprocessed once. The queries are preprocessed before each recognition, as in main.cpp.
+	struct BenchmarkCorpus
+	{
+		std::vector<Stroke> strokes;
+		std::vector<Stroke> templates;
+		std::vector<Stroke> queries;
+
+		TemplateBank bank;
+		QuantizedTemplateBank quantizedBank;
+	};
+
+	// The result of recognizing every query with a template bank.
+	struct BankResults
+	{
+		std::vector<int> matchingIndices;
+		std::vector<float> scores;
+		int correctCount = 0;
+		double timePerQuery = 0.0;
+	};
+
+	// Returns a copy of the stroke that looks like it was drawn again by the user.
+	Stroke Jitter(const Stroke& stroke, Random& random)
+	{
+		static const float PI = 2.0f * std::acos(0.0f);
+
+		Stroke jitteredStroke = stroke.RotateBy(random.Float(-PI / 9.0f, PI / 9.0f));
+
+		const float scaleX = random.Float(0.85f, 1.15f);
+		const float scaleY = random.Float(0.85f, 1.15f);
+		const Vector2 offset(random.Float(-50.0f, 50.0f), random.Float(-50.0f, 50.0f));
+
+		for (int i = 0; i < jitteredStroke.GetPointCount(); ++i)
+		{
+			Vector2 point = jitteredStroke.GetPoint(i);
+			point.x = point.x * scaleX + offset.x + random.Float(-1.5f, 1.5f);
+			point.y = point.y * scaleY + offset.y + random.Float(-1.5f, 1.5f);
+
+			jitteredStroke.SetPoint(i, point);
+		}
+
+		return jitteredStroke;
+	}
+
+	void BuildCorpus(const std::vector<Stroke>& strokes, int samplesPerStroke, BenchmarkCorpus& corpus)
+	{
+		Random random;
+		random.Seed(SEED);
+
+		corpus.strokes.reserve(strokes.size() * samplesPerStroke);
+		corpus.templates.reserve(strokes.size() * samplesPerStroke);
+		corpus.queries.reserve(strokes.size() * QUERIES_PER_STROKE);
+
+		for (const Stroke& stroke : strokes)
+		{
+			for (int i = 0; i < samplesPerStroke; ++i)
+			{
+				corpus.strokes.push_back(Jitter(stroke, random));
+				corpus.templates.push_back(corpus.strokes.back().Normalize(64, SIZE));
+			}
+
+			for (int i = 0; i < QUERIES_PER_STROKE; ++i)
+				corpus.queries.push_back(Jitter(stroke, random));
+		}
+
+		corpus.bank.Build(corpus.strokes);
+		corpus.quantizedBank.Build(corpus.bank);
+	}
+
+	double GetElapsedMicroseconds(const std::chrono::steady_clock::time_point& start)
+	{
+		return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// Normalizes every stroke with the chain of Stroke transforms, then with the fused pipeline and with the batched normalization, and compares the results.
+	void BenchmarkNormalization(const BenchmarkCorpus& corpus, std::ostream& out)
+	{
+		std::vector<Stroke> normalizedStrokes;
+		normalizedStrokes.reserve(corpus.strokes.size());
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (const Stroke& stroke : corpus.strokes)
+			normalizedStrokes.push_back(stroke.Normalize(64, SIZE));
+		const double chainElapsed = GetElapsedMicroseconds(start);
+
+		std::vector<Vector2> points(corpus.strokes.size() * 64);
+
+		start = std::chrono::steady_clock::now();
+		for (int i = 0; i < (int)corpus.strokes.size(); ++i)
+			(corpus.strokes[i] | Resample(64) | RotateByIndicativeAngle() | Scale(SIZE) | Translate()).Evaluate(points.data() + i * 64);
+		const double pipelineElapsed = GetElapsedMicroseconds(start);
+
+		std::vector<float> batchXs(corpus.strokes.size() * 64);
+		std::vector<float> batchYs(corpus.strokes.size() * 64);
+
+		start = std::chrono::steady_clock::now();
+		NormalizeStrokes(corpus.strokes.data(), corpus.strokes.size(), 64, SIZE, batchXs.data(), batchYs.data());
+		const double batchElapsed = GetElapsedMicroseconds(start);
+
+		float maxDifference = 0.0f;
+		int batchDifferenceCount = 0;
+		for (int i = 0; i < (int)corpus.strokes.size(); ++i)
+		{
+			for (int j = 0; j < 64; ++j)
+			{
+				const Vector2& point = normalizedStrokes[i].GetPoint(j);
+				maxDifference = std::fmax(maxDifference, Vector2::Distance(point, points[i * 64 + j]));
+
+				// The batch does the same operations as the chain, so it only differs if the compiler fuses the multiply-adds of the chain.
+				if (point.x != batchXs[i * 64 + j] || point.y != batchYs[i * 64 + j])
+					++batchDifferenceCount;
+			}
+		}
+
+		out << "Normalization:" << std::endl;
+		out << "\tChain of transforms:     " << chainElapsed / corpus.strokes.size() << " us per stroke" << std::endl;
+		out << "\tFused pipeline:          " << pipelineElapsed / corpus.strokes.size() << " us per stroke" << std::endl;
+		out << "\tMax point difference:    " << std::setprecision(5) << maxDifference << std::setprecision(2) << std::endl;
+		out << "\tBatched SIMD:            " << batchElapsed / corpus.strokes.size() << " us per stroke" << std::endl;
+		out << "\tPoints unlike the chain: " << batchDifferenceCount << std::endl;
+		out << std::endl;
+	}
+
+	// Resamples every stroke at several resolutions by walking the path each time (Stroke::Resample), then from the cumulative arc lengths, which are measured once per stroke.
+	void BenchmarkResampling(const BenchmarkCorpus& corpus, std::ostream& out)
+	{
+		const int RESOLUTIONS[] = { 16, 32, 64, 128 };
+
+		// Copy the strokes, so that their cumulative arc lengths are not cached yet.
+		std::vector<Stroke> strokes = corpus.strokes;
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (const Stroke& stroke : strokes)
+		{
+			for (int resolution : RESOLUTIONS)
+				stroke.Resample(resolution);
+		}
+		const double walkElapsed = GetElapsedMicroseconds(start);
+
+		start = std::chrono::steady_clock::now();
+		for (const Stroke& stroke : strokes)
+		{
+			for (int resolution : RESOLUTIONS)
+				stroke.ResampleByArcLength(resolution);
+		}
+		const double arcLengthElapsed = GetElapsedMicroseconds(start);
+
+		float maxDifference = 0.0f;
+		for (const Stroke& stroke : strokes)
+		{
+			Stroke walkedStroke = stroke.Resample(64);
+			Stroke arcLengthStroke = stroke.ResampleByArcLength(64);
+
+			for (int j = 0; j < 64; ++j)
+				maxDifference = std::fmax(maxDifference, Vector2::Distance(walkedStroke.GetPoint(j), arcLengthStroke.GetPoint(j)));
+		}
+
+		out << "Resampling at 16, 32, 64 and 128 points:" << std::endl;
+		out << "\tWalking the path:        " << walkElapsed / strokes.size() << " us per stroke" << std::endl;
+		out << "\tCumulative arc lengths:  " << arcLengthElapsed / strokes.size() << " us per stroke" << std::endl;
+		out << "\tMax point difference:    " << std::setprecision(5) << maxDifference << std::setprecision(2) << std::endl;
+		out << std::endl;
+	}
+
+	// Recognizes every query with Stroke::Recognize.
+	void BenchmarkLinearScan(BenchmarkCorpus& corpus, std::ostream& out)
+	{
+		int correctCount = 0;
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (const Stroke& query : corpus.queries)
+		{
+			// As in main.cpp, the temporary strokes are allocated from an arena that is released after each query.
+			std::pmr::monotonic_buffer_resource queryArena;
+
+			Stroke matchingStroke;
+			float score;
+			query.Normalize(64, SIZE, &queryArena).Recognize(corpus.templates, SIZE, matchingStroke, score, &queryArena);
+
+			if (matchingStroke.name == query.name)
+				++correctCount;
+		}
+		const double elapsed = GetElapsedMicroseconds(start);
+
+		out << "Linear scan (Stroke::Recognize):" << std::endl;
+		out << "\tTime per query:          " << elapsed / corpus.queries.size() << " us" << std::endl;
+		out << "\tAccuracy:                " << 100.0 * correctCount / corpus.queries.size() << "%" << std::endl;
+		WorkCounters::GetTotal().Print(out, WorkCounters::GetRecognitionCount());
+		out << std::endl;
+	}
+
+	// Recognizes every query with a template bank.
+	template <typename Bank>
+	void RecognizeQueries(const BenchmarkCorpus& corpus, const Bank& bank, BankResults& results)
+	{
+		WorkCounters::ResetTotal();
+
+		results.matchingIndices.assign(corpus.queries.size(), -1);
+		results.scores.assign(corpus.queries.size(), 0.0f);
+		results.correctCount = 0;
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < corpus.queries.size(); ++i)
+		{
+			std::pmr::monotonic_buffer_resource queryArena;
+
+			bank.Recognize(corpus.queries[i].Normalize(bank.GetPointCount(), bank.GetSize(), &queryArena), results.matchingIndices[i], results.scores[i], &queryArena);
+
+			if (results.matchingIndices[i] >= 0 && bank.GetName(results.matchingIndices[i]) == corpus.queries[i].name.c_str())
+				++results.correctCount;
+		}
+		results.timePerQuery = GetElapsedMicroseconds(start) / corpus.queries.size();
+	}
+
+	// Recognizes every query with a template bank and prints the time per query, the accuracy and the memory used by the templates.
+	template <typename Bank>
+	void BenchmarkBank(const BenchmarkCorpus& corpus, const Bank& bank, const char* title, BankResults& results, std::ostream& out)
+	{
+		RecognizeQueries(corpus, bank, results);
+
+		out << title << ":" << std::endl;
+		out << "\tTime per query:          " << results.timePerQuery << " us" << std::endl;
+		out << "\tAccuracy:                " << 100.0 * results.correctCount / corpus.queries.size() << "%" << std::endl;
+		out << "\tTemplate memory:         " << bank.GetMemoryUsage() / 1024.0 << " KB" << std::endl;
+		WorkCounters::GetTotal().Print(out, WorkCounters::GetRecognitionCount());
+		out << std::endl;
+	}
+
+	// Compares the float template bank with and without rotation tables of several angular resolutions.
+	void BenchmarkRotationTables(const BenchmarkCorpus& corpus, std::ostream& out)
+	{
+		static const float PI = 2.0f * std::acos(0.0f);
+		const int ANGLE_STEPS[] = { 0, 15, 10, 5, 2 };
+
+		out << "Rotation tables (template bank rotated every n degrees):" << std::endl;
+		out << "\tStep  Refined  Time per query  Accuracy  Memory        Distance evaluations" << std::endl;
+
+		for (int angleStep : ANGLE_STEPS)
+		{
+			for (int refine = 0; refine < 2; ++refine)
+			{
+				// Without a table, the golden-section search is always used.
+				if (angleStep == 0 && refine == 1)
+					continue;
+
+				TemplateBank bank = corpus.bank;
+				bank.SetRotationTable(angleStep * PI / 180.0f, refine == 1);
+
+				BankResults results;
+				RecognizeQueries(corpus, bank, results);
+
+				out << "\t" << std::left;
+				if (angleStep == 0)
+					out << std::setw(6) << "none" << std::setw(9) << "-";
+				else
+					out << std::setw(6) << angleStep << std::setw(9) << (refine == 1 ? "yes" : "no");
+				out << std::right;
+				out << std::setw(11) << results.timePerQuery << " us";
+				out << std::setw(9) << 100.0 * results.correctCount / corpus.queries.size() << "%";
+				out << std::setw(10) << bank.GetMemoryUsage() / 1024.0 << " KB";
+				out << std::setw(23) << (double)WorkCounters::GetTotal().distanceEvaluations / WorkCounters::GetRecognitionCount() << std::endl;
+			}
+		}
+
+		out << std::endl;
+	}
+
+	// Prints how often another bank picks the same template as the reference bank and how much the scores differ.
+	void CompareBankResults(const BankResults& referenceResults, const BankResults& otherResults, const char* title, std::ostream& out)
+	{
+		const size_t queryCount = referenceResults.matchingIndices.size();
+
+		int agreementCount = 0;
+		double scoreDifference = 0.0;
+		double maxScoreDifference = 0.0;
+
+		for (size_t i = 0; i < queryCount; ++i)
+		{
+			if (referenceResults.matchingIndices[i] == otherResults.matchingIndices[i])
+				++agreementCount;
+
+			const double difference = std::abs(referenceResults.scores[i] - otherResults.scores[i]);
+			scoreDifference += difference;
+			if (difference > maxScoreDifference)
+				maxScoreDifference = difference;
+		}
+
+		out << title << ":" << std::endl;
+		out << "\tSame match:              " << 100.0 * agreementCount / queryCount << "%" << std::endl;
+		out << std::setprecision(5);
+		out << "\tScore difference:        " << scoreDifference / queryCount << " (max " << maxScoreDifference << ")" << std::endl;
+		out << std::setprecision(2);
+		out << std::endl;
+	}
+
+	// Returns the index of the template nearest to the query at the indicative angle, by comparing it with every template.
+	int FindNearestTemplate(const TemplateBank& bank, const Stroke& query)
+	{
+		std::vector<float> queryX(bank.GetPointCount());
+		std::vector<float> queryY(bank.GetPointCount());
+		for (int i = 0; i < bank.GetPointCount(); ++i)
+		{
+			queryX[i] = query.GetPoint(i).x;
+			queryY[i] = query.GetPoint(i).y;
+		}
+
+		int nearestIndex = -1;
+		float nearestDistance = std::numeric_limits<float>::infinity();
+		for (int i = 0; i < bank.GetTemplateCount(); ++i)
+		{
+			float distance = GetPathDistance(queryX.data(), queryY.data(), bank.GetX(i), bank.GetY(i), bank.GetPointCount());
+			if (distance < nearestDistance)
+			{
+				nearestDistance = distance;
+				nearestIndex = i;
+			}
+		}
+
+		return nearestIndex;
+	}
+
+	// Recognizes the queries with a VP-tree built at once, checks that it finds the same templates as a linear scan at the same angle,
+	// then builds a tree by insertions and removes the templates of the first stroke,
+	// and finally removes every name but the first and the last one to check that the compaction keeps the names of the other templates.
+	void BenchmarkVantagePointTree(const BenchmarkCorpus& corpus, std::ostream& out)
+	{
+		VantagePointTree tree;
+		tree.Build(corpus.bank);
+
+		BankResults treeResults;
+		BenchmarkBank(corpus, tree, "VP-tree (at the indicative angle)", treeResults, out);
+
+		int exactCount = 0;
+		for (size_t i = 0; i < corpus.queries.size(); ++i)
+		{
+			const int nearestIndex = FindNearestTemplate(corpus.bank, corpus.queries[i].Normalize(64, SIZE));
+			if (nearestIndex == treeResults.matchingIndices[i])
+				++exactCount;
+		}
+
+		VantagePointTree insertedTree;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (const Stroke& normalizedStroke : corpus.templates)
+			insertedTree.Insert(normalizedStroke);
+		const double insertTime = GetElapsedMicroseconds(start) / corpus.templates.size();
+
+		BankResults insertedResults;
+		RecognizeQueries(corpus, insertedTree, insertedResults);
+		const double insertedEvaluations = (double)WorkCounters::GetTotal().distanceEvaluations / WorkCounters::GetRecognitionCount();
+
+		const std::string removedName(corpus.strokes[0].name.begin(), corpus.strokes[0].name.end());
+		const int removedCount = insertedTree.Remove(removedName);
+
+		BankResults removedResults;
+		RecognizeQueries(corpus, insertedTree, removedResults);
+
+		int removedMatchCount = 0;
+		for (int matchingIndex : removedResults.matchingIndices)
+		{
+			if (matchingIndex >= 0 && insertedTree.GetName(matchingIndex) == removedName)
+				++removedMatchCount;
+		}
+
+		// The removals compact the templates, with some kept templates before the removed ones and some after them.
+		VantagePointTree compactedTree;
+		compactedTree.Build(corpus.bank);
+
+		const std::string firstName = corpus.bank.GetName(0);
+		const std::string lastName = corpus.bank.GetName(corpus.bank.GetTemplateCount() - 1);
+
+		int keptCount = 0;
+		for (int i = 0; i < corpus.bank.GetTemplateCount(); ++i)
+		{
+			const std::string& name = corpus.bank.GetName(i);
+			if (name == firstName || name == lastName)
+				++keptCount;
+			else
+				compactedTree.Remove(name);
+		}
+
+		// The names left in the tree must be in the same order as in the bank. The removed templates that are not compacted yet keep their names too.
+		int foundCount = 0;
+		int bankIndex = 0;
+		bool areNamesIntact = true;
+		for (int i = 0; i < compactedTree.GetTemplateCount() && areNamesIntact; ++i)
+		{
+			while (bankIndex < corpus.bank.GetTemplateCount() && corpus.bank.GetName(bankIndex) != compactedTree.GetName(i))
+				++bankIndex;
+
+			if (bankIndex == corpus.bank.GetTemplateCount())
+				areNamesIntact = false;
+			else if (compactedTree.GetName(i) == firstName || compactedTree.GetName(i) == lastName)
+				++foundCount;
+
+			++bankIndex;
+		}
+
+		if (foundCount != keptCount)
+			areNamesIntact = false;
+
+		out << "VP-tree updates:" << std::endl;
+		out << "\tSame match as linear scan:    " << 100.0 * exactCount / corpus.queries.size() << "%" << std::endl;
+		out << "\tTime per insertion:           " << insertTime << " us" << std::endl;
+		out << "\tTime per query (inserted):    " << insertedResults.timePerQuery << " us, " << insertedEvaluations << " distance evaluations" << std::endl;
+		out << "\tAccuracy (inserted):          " << 100.0 * insertedResults.correctCount / corpus.queries.size() << "%" << std::endl;
+		out << "\tMatches of removed \"" << removedName << "\": " << removedMatchCount << " (" << removedCount << " templates removed)" << std::endl;
+		out << "\tNames after compaction:       " << (areNamesIntact ? "intact" : "CHANGED") << " (" << compactedTree.GetTemplateCount() << " templates left)" << std::endl;
+		out << std::endl;
+	}
+
+	// Compares LSH indices of several sizes with the linear scan of the float template bank.
+	// The recall is the share of the queries for which the index finds the same template as the linear scan.
+	void BenchmarkLshIndices(const BenchmarkCorpus& corpus, const BankResults& linearResults, std::ostream& out)
+	{
+		const int CONFIGURATION_COUNT = 6;
+		const int TABLE_COUNTS[CONFIGURATION_COUNT] = { 4, 8, 16, 4, 8, 16 };
+		const int BIT_COUNTS[CONFIGURATION_COUNT] = { 8, 8, 8, 16, 16, 16 };
+
+		out << "LSH indices (compared with the linear scan of the template bank):" << std::endl;
+		out << "\tTables  Bits  Compared templates  Time per query  Speedup  Recall   Accuracy" << std::endl;
+
+		for (int i = 0; i < CONFIGURATION_COUNT; ++i)
+		{
+			LshIndex index(TABLE_COUNTS[i], BIT_COUNTS[i]);
+			index.Build(corpus.bank);
+
+			BankResults results;
+			RecognizeQueries(corpus, index, results);
+
+			int recallCount = 0;
+			for (size_t j = 0; j < corpus.queries.size(); ++j)
+			{
+				if (results.matchingIndices[j] == linearResults.matchingIndices[j])
+					++recallCount;
+			}
+
+			const double comparedCount = corpus.bank.GetTemplateCount() - (double)WorkCounters::GetTotal().templatesSkipped / WorkCounters::GetRecognitionCount();
+
+			out << "\t" << std::left << std::setw(8) << TABLE_COUNTS[i] << std::setw(6) << BIT_COUNTS[i] << std::right;
+			out << std::setw(18) << comparedCount;
+			out << std::setw(13) << results.timePerQuery << " us";
+			out << std::setw(8) << linearResults.timePerQuery / results.timePerQuery << "x";
+			out << std::setw(8) << 100.0 * recallCount / corpus.queries.size() << "%";
+			out << std::setw(10) << 100.0 * results.correctCount / corpus.queries.size() << "%" << std::endl;
+		}
+
+		out << std::endl;
+	}
+
+	// Compares the class filter of the template bank for several numbers of classes with the linear scan.
+	void BenchmarkClassFilters(const BenchmarkCorpus& corpus, const BankResults& linearResults, std::ostream& out)
+	{
+		const int CLASS_COUNTS[] = { 1, 2, 3, 5, 10 };
+
+		out << "Class filters (medoid of each name first, then the samples of the k closest names):" << std::endl;
+		out << "\tk     Compared templates  Time per query  Speedup  Same match  Accuracy" << std::endl;
+
+		for (int classCount : CLASS_COUNTS)
+		{
+			TemplateBank bank = corpus.bank;
+			bank.SetClassFilter(classCount);
+			if (classCount >= bank.GetClassCount())
+				break;
+
+			BankResults results;
+			RecognizeQueries(corpus, bank, results);
+
+			int sameCount = 0;
+			for (size_t j = 0; j < corpus.queries.size(); ++j)
+			{
+				if (results.matchingIndices[j] == linearResults.matchingIndices[j])
+					++sameCount;
+			}
+
+			// The medoids are compared too.
+			const double comparedCount = bank.GetClassCount() + bank.GetTemplateCount() - (double)WorkCounters::GetTotal().templatesSkipped / WorkCounters::GetRecognitionCount();
+
+			out << "\t" << std::left << std::setw(6) << classCount << std::right;
+			out << std::setw(18) << comparedCount;
+			out << std::setw(13) << results.timePerQuery << " us";
+			out << std::setw(8) << linearResults.timePerQuery / results.timePerQuery << "x";
+			out << std::setw(11) << 100.0 * sameCount / corpus.queries.size() << "%";
+			out << std::setw(9) << 100.0 * results.correctCount / corpus.queries.size() << "%" << std::endl;
+		}
+
+		out << std::endl;
+	}
+
+	// Compares the feature cascade of the template bank for several tolerances with the linear scan.
+	// The features of each query are computed before the recognition, so their cost is included in the time per query.
+	void BenchmarkFeatureCascades(const BenchmarkCorpus& corpus, const BankResults& linearResults, std::ostream& out)
+	{
+		const float TOLERANCES[] = { 0.25f, 0.5f, 1.0f, 2.0f };
+
+		out << "Feature cascades (aspect ratio, path length ratio, direction and closedness of each name):" << std::endl;
+		out << "\tTolerance  Rejected  Time per query  Speedup  Same match  Accuracy" << std::endl;
+
+		for (float tolerance : TOLERANCES)
+		{
+			TemplateBank bank = corpus.bank;
+			bank.SetFeatureCascade(tolerance);
+
+			WorkCounters::ResetTotal();
+
+			int sameCount = 0;
+			int correctCount = 0;
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			for (size_t i = 0; i < corpus.queries.size(); ++i)
+			{
+				std::pmr::monotonic_buffer_resource queryArena;
+
+				const Stroke& query = corpus.queries[i];
+				const StrokeFeatures features = query.GetFeatures(bank.GetPointCount(), &queryArena);
+
+				int matchingIndex;
+				float score;
+				bank.Recognize(query.Normalize(bank.GetPointCount(), bank.GetSize(), &queryArena), features, matchingIndex, score, &queryArena);
+
+				if (matchingIndex == linearResults.matchingIndices[i])
+					++sameCount;
+				if (matchingIndex >= 0 && bank.GetName(matchingIndex) == query.name.c_str())
+					++correctCount;
+			}
+			const double timePerQuery = GetElapsedMicroseconds(start) / corpus.queries.size();
+
+			const double rejectedRate = (double)WorkCounters::GetTotal().templatesSkipped / WorkCounters::GetRecognitionCount() / bank.GetTemplateCount();
+
+			out << "\t" << std::left << std::setw(11) << tolerance << std::right;
+			out << std::setw(7) << 100.0 * rejectedRate << "%";
+			out << std::setw(13) << timePerQuery << " us";
+			out << std::setw(8) << linearResults.timePerQuery / timePerQuery << "x";
+			out << std::setw(11) << 100.0 * sameCount / corpus.queries.size() << "%";
+			out << std::setw(9) << 100.0 * correctCount / corpus.queries.size() << "%" << std::endl;
+		}
+
+		out << std::endl;
+	}
+
+#ifdef GESTURE_TRACK_ALLOCATIONS
+	// Checks that recognizing a preprocessed query against the preloaded templates does not touch the heap once warmed up.
+	// Returns false if any recognition allocates.
+	bool CheckZeroAllocations(const BenchmarkCorpus& corpus, std::ostream& out)
+	{
+		std::vector<Stroke> normalizedQueries;
+		normalizedQueries.reserve(corpus.queries.size());
+		for (const Stroke& query : corpus.queries)
+			normalizedQueries.push_back(query.Normalize(64, SIZE));
+
+		// The arena cannot fall back to the heap, so it fails loudly if it is too small.
+		std::vector<char> arenaBuffer(ARENA_SIZE);
+		std::pmr::monotonic_buffer_resource arena(arenaBuffer.data(), arenaBuffer.size(), std::pmr::null_memory_resource());
+
+		Stroke matchingStroke;
+		int matchingIndex;
+		float score;
+
+		// Warm up, e.g. so that the matching stroke has room for the longest name.
+		for (const Stroke& query : normalizedQueries)
+		{
+			query.Recognize(corpus.templates, SIZE, matchingStroke, score, &arena);
+			arena.release();
+		}
+
+		AllocationCounts total;
+		uint64_t maxAllocations = 0;
+
+		for (const Stroke& query : normalizedQueries)
+		{
+			const AllocationCounts before = AllocationTracker::GetThreadCounts();
+
+			query.Recognize(corpus.templates, SIZE, matchingStroke, score, &arena);
+			arena.release();
+
+			corpus.bank.Recognize(query, matchingIndex, score, &arena);
+			arena.release();
+
+			corpus.quantizedBank.Recognize(query, matchingIndex, score, &arena);
+			arena.release();
+
+			const AllocationCounts recognitionCounts = AllocationTracker::GetThreadCounts() - before;
+			total.allocations += recognitionCounts.allocations;
+			total.bytes += recognitionCounts.bytes;
+			if (recognitionCounts.allocations > maxAllocations)
+				maxAllocations = recognitionCounts.allocations;
+		}
+
+		const bool passed = total.allocations == 0;
+
+		out << "Heap allocations per recognition after warm-up:" << std::endl;
+		out << "	Allocations:             " << (double)total.allocations / normalizedQueries.size() << " (max " << maxAllocations << ")" << std::endl;
+		out << "	Bytes:                   " << (double)total.bytes / normalizedQueries.size() << std::endl;
+		out << "	Zero-allocation check:   " << (passed ? "passed" : "FAILED") << std::endl;
+		out << std::endl;
+
+		return passed;
+	}
+#endif
+}
+
+int RunBenchmark(const std::vector<Stroke>& strokes, int samplesPerStroke, std::ostream& out)
+{
+	if (strokes.size() == 0 || samplesPerStroke < 1)
+	{
+		std::cerr << "Error: Cannot run the benchmark: There is no saved stroke." << std::endl;
+		return 1;
+	}
+
+	// The hardware counters also cover the preprocessing of the templates.
+	PerfCounters::Reset();
+
+	BenchmarkCorpus corpus;
+	BuildCorpus(strokes, samplesPerStroke, corpus);
+
+	out << std::fixed << std::setprecision(2);
+	out << "Templates: " << corpus.templates.size() << " (" << samplesPerStroke << " per stroke), queries: " << corpus.queries.size() << std::endl;
+	out << std::endl;
+
+	BenchmarkNormalization(corpus, out);
+	BenchmarkResampling(corpus, out);
+
+	// Only measure the recognition.
+	Profiler::Reset();
+	WorkCounters::ResetTotal();
+
+	BenchmarkLinearScan(corpus, out);
+
+	BankResults floatResults;
+	BankResults quantizedResults;
+	BenchmarkBank(corpus, corpus.bank, "Template bank (float)", floatResults, out);
+	BenchmarkBank(corpus, corpus.quantizedBank, "Template bank (16-bit fixed point)", quantizedResults, out);
+	CompareBankResults(floatResults, quantizedResults, "Fixed point compared with float", out);
+
+	BankResults parallelResults;
+	TemplateBank parallelBank = corpus.bank;
+	parallelBank.SetAngleSearchMethod(AngleSearchMethod::ParallelBracketing);
+	BenchmarkBank(corpus, parallelBank, "Template bank (parallel angle search)", parallelResults, out);
+	CompareBankResults(floatResults, parallelResults, "Parallel angle search compared with golden section", out);
+
+	BankResults interleavedResults;
+	TemplateBank interleavedBank = corpus.bank;
+	interleavedBank.SetLayout(TemplateLayout::Interleaved);
+	BenchmarkBank(corpus, interleavedBank, "Template bank (8 interleaved templates)", interleavedResults, out);
+	CompareBankResults(floatResults, interleavedResults, "Interleaved templates compared with one template at a time", out);
+
+	BenchmarkRotationTables(corpus, out);
+
+	BenchmarkVantagePointTree(corpus, out);
+
+	BenchmarkLshIndices(corpus, floatResults, out);
+
+	BenchmarkClassFilters(corpus, floatResults, out);
+
+	BenchmarkFeatureCascades(corpus, floatResults, out);
+
+#ifdef GESTURE_PROFILING
+	Profiler::Dump(out);
+	out << std::endl;
+#endif
+
+#if defined(GESTURE_PERF_COUNTERS) && defined(__linux__)
+	PerfCounters::Dump(out);
+	out << std::endl;
+#endif
+
+#ifdef GESTURE_TRACK_ALLOCATIONS
+	if (!CheckZeroAllocations(corpus, out))
+		return 1;
+#endif
+
+	return 0;
+}
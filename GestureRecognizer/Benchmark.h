@@ -0,0 +1,13 @@
+// Benchmark.h
+// Programmer: Khoi Ho
+
+#pragma once
+
+#include <ostream>
+#include <vector>
+#include "Stroke.h"
+
+// Measures the speed, the accuracy and the work done by the recognition, and writes the results.
+// Each stroke spawns samplesPerStroke jittered templates and a few jittered queries with the same name, so the bank can be made as large as needed.
+// Returns the exit code of the program.
+int RunBenchmark(const std::vector<Stroke>& strokes, int samplesPerStroke, std::ostream& out);
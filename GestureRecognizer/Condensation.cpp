@@ -0,0 +1,152 @@
+#include "Condensation.h"
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <thread>
+#include "ParallelFor.h"
+#include "Tracer.h"
+
+namespace
+{
+	const float PI = 2.0f * std::acos(0.0f);
+
+	// Returns the stroke nearest to stroke i among the kept strokes other than i, or -1 if there is none.
+	int FindNearestStroke(const std::vector<float>& distances, int strokeCount, int i, const std::vector<char>& isKept)
+	{
+		int nearestIndex = -1;
+		float nearestDistance = std::numeric_limits<float>::infinity();
+
+		for (int j = 0; j < strokeCount; ++j)
+		{
+			if (j != i && isKept[j] && distances[i * strokeCount + j] < nearestDistance)
+			{
+				nearestDistance = distances[i * strokeCount + j];
+				nearestIndex = j;
+			}
+		}
+
+		return nearestIndex;
+	}
+
+	// Returns the share of the strokes that are recognized as their own name by the other kept strokes.
+	double GetLeaveOneOutAccuracy(const std::vector<Stroke>& strokes, const std::vector<float>& distances, const std::vector<char>& isKept)
+	{
+		const int strokeCount = strokes.size();
+
+		int correctCount = 0;
+		for (int i = 0; i < strokeCount; ++i)
+		{
+			const int nearestIndex = FindNearestStroke(distances, strokeCount, i, isKept);
+			if (nearestIndex >= 0 && strokes[nearestIndex].name == strokes[i].name)
+				++correctCount;
+		}
+
+		return strokeCount > 0 ? (double)correctCount / strokeCount : 0.0;
+	}
+}
+
+std::vector<Stroke> CondenseStrokes(const std::vector<Stroke>& strokes, std::ostream& out)
+{
+	TRACE_SCOPE("CondenseStrokes", "preprocessing");
+
+	const int strokeCount = strokes.size();
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	std::vector<Stroke> normalizedStrokes(strokeCount);
+	ParallelFor(strokeCount, [&](int i)
+	{
+		normalizedStrokes[i] = strokes[i].Normalize();
+	});
+
+	// Row i holds the distances from stroke i, as a candidate, to every stroke as a template, as in Recognize.
+	std::vector<float> distances(strokeCount * strokeCount, 0.0f);
+	ParallelFor(strokeCount, [&](int i)
+	{
+		Stroke rotatedStroke;
+		for (int j = 0; j < strokeCount; ++j)
+		{
+			if (j != i)
+				distances[i * strokeCount + j] = normalizedStrokes[i].GetDistanceAtBestAngle(normalizedStrokes[j], -0.25f * PI, 0.25f * PI, PI / 90.0f, rotatedStroke);
+		}
+	});
+
+	const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	// Start from all the strokes and the name each one is recognized as by the others.
+	std::vector<char> isKept(strokeCount, true);
+	std::vector<int> nearestIndices(strokeCount);
+	for (int i = 0; i < strokeCount; ++i)
+		nearestIndices[i] = FindNearestStroke(distances, strokeCount, i, isKept);
+
+	// Remove a stroke if every stroke that was recognized through it is still recognized as the same name without it.
+	// The last stroke of a name is never removed, so that no name is lost.
+	std::vector<int> changedIndices;
+	std::vector<int> changedNearestIndices;
+	for (int i = 0; i < strokeCount; ++i)
+	{
+		bool isLastOfName = true;
+		for (int j = 0; j < strokeCount && isLastOfName; ++j)
+		{
+			if (j != i && isKept[j] && strokes[j].name == strokes[i].name)
+				isLastOfName = false;
+		}
+
+		if (isLastOfName)
+			continue;
+
+		isKept[i] = false;
+		changedIndices.clear();
+		changedNearestIndices.clear();
+
+		bool isDecisionChanged = false;
+		for (int j = 0; j < strokeCount && !isDecisionChanged; ++j)
+		{
+			if (nearestIndices[j] != i)
+				continue;
+
+			const int nearestIndex = FindNearestStroke(distances, strokeCount, j, isKept);
+			if (nearestIndex < 0 || strokes[nearestIndex].name != strokes[i].name)
+				isDecisionChanged = true;
+
+			changedIndices.push_back(j);
+			changedNearestIndices.push_back(nearestIndex);
+		}
+
+		if (isDecisionChanged)
+		{
+			isKept[i] = true;
+			continue;
+		}
+
+		for (size_t k = 0; k < changedIndices.size(); ++k)
+			nearestIndices[changedIndices[k]] = changedNearestIndices[k];
+	}
+
+	std::vector<Stroke> condensedStrokes;
+	for (int i = 0; i < strokeCount; ++i)
+	{
+		if (isKept[i])
+			condensedStrokes.push_back(strokes[i]);
+	}
+
+	const std::vector<char> isAllKept(strokeCount, true);
+	const double accuracy = GetLeaveOneOutAccuracy(strokes, distances, isAllKept);
+	const double condensedAccuracy = GetLeaveOneOutAccuracy(strokes, distances, isKept);
+
+	std::ios::fmtflags flags = out.flags();
+	std::streamsize precision = out.precision();
+
+	out << std::fixed << std::setprecision(2);
+	out << "Condensation:" << std::endl;
+	out << "\tTemplates:               " << strokeCount << " -> " << condensedStrokes.size();
+	out << " (" << (strokeCount > 0 ? 100.0 * (strokeCount - (int)condensedStrokes.size()) / strokeCount : 0.0) << "% removed)" << std::endl;
+	out << "\tLeave-one-out accuracy:  " << 100.0 * accuracy << "% -> " << 100.0 * condensedAccuracy << "%" << std::endl;
+	out << "\tDistance matrix:         " << elapsed << " s on " << std::max(1u, std::thread::hardware_concurrency()) << " threads" << std::endl;
+
+	out.flags(flags);
+	out.precision(precision);
+
+	return condensedStrokes;
+}
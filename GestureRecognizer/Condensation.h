@@ -0,0 +1,14 @@
+// Condensation.h
+// Programmer: Khoi Ho
+
+#pragma once
+
+#include <ostream>
+#include <vector>
+#include "Stroke.h"
+
+// Removes the strokes that the recognition does not need: in turn, each stroke is removed if every stroke still recognizes the same name
+// as before when it is compared with the other remaining strokes (leave-one-out). So the leave-one-out accuracy does not change.
+// The distances between all the strokes are computed on all the hardware threads.
+// Prints the reduction and the leave-one-out accuracy before and after, and returns the kept strokes in their original order.
+std::vector<Stroke> CondenseStrokes(const std::vector<Stroke>& strokes, std::ostream& out);
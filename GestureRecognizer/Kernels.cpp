@@ -0,0 +1,378 @@
+#include "Kernels.h"
+#include <cmath>
+#include <limits>
+
+#ifdef GESTURE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+#ifdef GESTURE_SSE2
+	float HorizontalSum(__m128 values)
+	{
+		__m128 shuffled = _mm_shuffle_ps(values, values, _MM_SHUFFLE(2, 3, 0, 1));
+		__m128 sums = _mm_add_ps(values, shuffled);
+		shuffled = _mm_movehl_ps(shuffled, sums);
+		sums = _mm_add_ss(sums, shuffled);
+		return _mm_cvtss_f32(sums);
+	}
+#endif
+}
+
+void RotatePoints(const float* x, const float* y, int pointCount, float angle, float centerX, float centerY, float* rotatedX, float* rotatedY)
+{
+	const float cosAngle = std::cos(angle);
+	const float sinAngle = std::sin(angle);
+
+	for (int i = 0; i < pointCount; ++i)
+	{
+		rotatedX[i] = (x[i] - centerX) * cosAngle - (y[i] - centerY) * sinAngle + centerX;
+		rotatedY[i] = (x[i] - centerX) * sinAngle + (y[i] - centerY) * cosAngle + centerY;
+	}
+}
+
+float GetPathDistance(const float* ax, const float* ay, const float* bx, const float* by, int pointCount)
+{
+	float distance = 0.0f;
+	int i = 0;
+
+#ifdef GESTURE_SSE2
+	__m128 distances = _mm_setzero_ps();
+	for (; i + 4 <= pointCount; i += 4)
+	{
+		__m128 dx = _mm_sub_ps(_mm_loadu_ps(bx + i), _mm_loadu_ps(ax + i));
+		__m128 dy = _mm_sub_ps(_mm_loadu_ps(by + i), _mm_loadu_ps(ay + i));
+		distances = _mm_add_ps(distances, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy))));
+	}
+	distance = HorizontalSum(distances);
+#endif
+
+	for (; i < pointCount; ++i)
+	{
+		float dx = bx[i] - ax[i];
+		float dy = by[i] - ay[i];
+		distance += std::sqrt(dx * dx + dy * dy);
+	}
+
+	return distance / pointCount;
+}
+
+void GetPathDistancesAtAngles(const float* x, const float* y, int pointCount, const float* angles, float centerX, float centerY, const float* templateX, const float* templateY, float* distances)
+{
+	float cosAngles[ANGLE_LANES];
+	float sinAngles[ANGLE_LANES];
+	for (int k = 0; k < ANGLE_LANES; ++k)
+	{
+		cosAngles[k] = std::cos(angles[k]);
+		sinAngles[k] = std::sin(angles[k]);
+	}
+
+#ifdef GESTURE_SSE2
+	// Each lane holds one angle, so every point is loaded once for all the angles.
+	const __m128 cosAngle = _mm_loadu_ps(cosAngles);
+	const __m128 sinAngle = _mm_loadu_ps(sinAngles);
+	const __m128 centerXs = _mm_set1_ps(centerX);
+	const __m128 centerYs = _mm_set1_ps(centerY);
+	__m128 sums = _mm_setzero_ps();
+
+	for (int i = 0; i < pointCount; ++i)
+	{
+		const __m128 dx = _mm_set1_ps(x[i] - centerX);
+		const __m128 dy = _mm_set1_ps(y[i] - centerY);
+
+		const __m128 rotatedX = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(dx, cosAngle), _mm_mul_ps(dy, sinAngle)), centerXs);
+		const __m128 rotatedY = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, sinAngle), _mm_mul_ps(dy, cosAngle)), centerYs);
+
+		const __m128 ex = _mm_sub_ps(_mm_set1_ps(templateX[i]), rotatedX);
+		const __m128 ey = _mm_sub_ps(_mm_set1_ps(templateY[i]), rotatedY);
+		sums = _mm_add_ps(sums, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(ex, ex), _mm_mul_ps(ey, ey))));
+	}
+
+	_mm_storeu_ps(distances, _mm_div_ps(sums, _mm_set1_ps((float)pointCount)));
+#else
+	for (int k = 0; k < ANGLE_LANES; ++k)
+	{
+		float sum = 0.0f;
+		for (int i = 0; i < pointCount; ++i)
+		{
+			float rotatedX = (x[i] - centerX) * cosAngles[k] - (y[i] - centerY) * sinAngles[k] + centerX;
+			float rotatedY = (x[i] - centerX) * sinAngles[k] + (y[i] - centerY) * cosAngles[k] + centerY;
+
+			float ex = templateX[i] - rotatedX;
+			float ey = templateY[i] - rotatedY;
+			sum += std::sqrt(ex * ex + ey * ey);
+		}
+
+		distances[k] = sum / pointCount;
+	}
+#endif
+}
+
+void GetPathDistancesToInterleavedTemplates(const float* x, const float* y, int pointCount, const float* angles, float centerX, float centerY, const float* templateX, const float* templateY, float* distances)
+{
+	float cosAngles[TEMPLATE_LANES];
+	float sinAngles[TEMPLATE_LANES];
+	for (int k = 0; k < TEMPLATE_LANES; ++k)
+	{
+		cosAngles[k] = std::cos(angles[k]);
+		sinAngles[k] = std::sin(angles[k]);
+	}
+
+#ifdef GESTURE_SSE2
+	// Each register holds 4 of the 8 lanes. Both are updated with the same candidate point.
+	const __m128 centerXs = _mm_set1_ps(centerX);
+	const __m128 centerYs = _mm_set1_ps(centerY);
+	const __m128 cosAngleLow = _mm_loadu_ps(cosAngles);
+	const __m128 cosAngleHigh = _mm_loadu_ps(cosAngles + 4);
+	const __m128 sinAngleLow = _mm_loadu_ps(sinAngles);
+	const __m128 sinAngleHigh = _mm_loadu_ps(sinAngles + 4);
+	__m128 sumsLow = _mm_setzero_ps();
+	__m128 sumsHigh = _mm_setzero_ps();
+
+	for (int i = 0; i < pointCount; ++i)
+	{
+		const __m128 dx = _mm_set1_ps(x[i] - centerX);
+		const __m128 dy = _mm_set1_ps(y[i] - centerY);
+		const float* templatePointX = templateX + i * TEMPLATE_LANES;
+		const float* templatePointY = templateY + i * TEMPLATE_LANES;
+
+		__m128 rotatedX = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(dx, cosAngleLow), _mm_mul_ps(dy, sinAngleLow)), centerXs);
+		__m128 rotatedY = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, sinAngleLow), _mm_mul_ps(dy, cosAngleLow)), centerYs);
+		__m128 ex = _mm_sub_ps(_mm_loadu_ps(templatePointX), rotatedX);
+		__m128 ey = _mm_sub_ps(_mm_loadu_ps(templatePointY), rotatedY);
+		sumsLow = _mm_add_ps(sumsLow, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(ex, ex), _mm_mul_ps(ey, ey))));
+
+		rotatedX = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(dx, cosAngleHigh), _mm_mul_ps(dy, sinAngleHigh)), centerXs);
+		rotatedY = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, sinAngleHigh), _mm_mul_ps(dy, cosAngleHigh)), centerYs);
+		ex = _mm_sub_ps(_mm_loadu_ps(templatePointX + 4), rotatedX);
+		ey = _mm_sub_ps(_mm_loadu_ps(templatePointY + 4), rotatedY);
+		sumsHigh = _mm_add_ps(sumsHigh, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(ex, ex), _mm_mul_ps(ey, ey))));
+	}
+
+	const __m128 count = _mm_set1_ps((float)pointCount);
+	_mm_storeu_ps(distances, _mm_div_ps(sumsLow, count));
+	_mm_storeu_ps(distances + 4, _mm_div_ps(sumsHigh, count));
+#else
+	for (int k = 0; k < TEMPLATE_LANES; ++k)
+	{
+		float sum = 0.0f;
+		for (int i = 0; i < pointCount; ++i)
+		{
+			float rotatedX = (x[i] - centerX) * cosAngles[k] - (y[i] - centerY) * sinAngles[k] + centerX;
+			float rotatedY = (x[i] - centerX) * sinAngles[k] + (y[i] - centerY) * cosAngles[k] + centerY;
+
+			float ex = templateX[i * TEMPLATE_LANES + k] - rotatedX;
+			float ey = templateY[i * TEMPLATE_LANES + k] - rotatedY;
+			sum += std::sqrt(ex * ex + ey * ey);
+		}
+
+		distances[k] = sum / pointCount;
+	}
+#endif
+}
+
+void QuantizePoints(const float* x, const float* y, int pointCount, int16_t* quantizedPoints)
+{
+	// The normalized points lie within [-size, size], so they fit in 16 bits with a few fractional bits.
+	// Clamp them to 15 bits anyway in case the stroke is degenerate, so that the differences never overflow.
+	const int LIMIT = (1 << 14) - 1;
+	int i = 0;
+
+#ifdef GESTURE_SSE2
+	const __m128 scale = _mm_set1_ps(QUANTIZATION_SCALE);
+	const __m128i upperLimit = _mm_set1_epi16(LIMIT);
+	const __m128i lowerLimit = _mm_set1_epi16(-LIMIT);
+	for (; i + 4 <= pointCount; i += 4)
+	{
+		// Round to the nearest integer, then interleave the x and y coordinates.
+		__m128i quantizedX = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(x + i), scale));
+		__m128i quantizedY = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(y + i), scale));
+		__m128i packed = _mm_packs_epi32(_mm_unpacklo_epi32(quantizedX, quantizedY), _mm_unpackhi_epi32(quantizedX, quantizedY));
+		packed = _mm_max_epi16(_mm_min_epi16(packed, upperLimit), lowerLimit);
+		_mm_storeu_si128((__m128i*)(quantizedPoints + 2 * i), packed);
+	}
+#endif
+
+	for (; i < pointCount; ++i)
+	{
+		float quantizedX = std::nearbyint(x[i] * QUANTIZATION_SCALE);
+		float quantizedY = std::nearbyint(y[i] * QUANTIZATION_SCALE);
+
+		quantizedPoints[2 * i] = (int16_t)std::fmax((float)-LIMIT, std::fmin((float)LIMIT, quantizedX));
+		quantizedPoints[2 * i + 1] = (int16_t)std::fmax((float)-LIMIT, std::fmin((float)LIMIT, quantizedY));
+	}
+}
+
+float GetQuantizedPathDistance(const int16_t* a, const int16_t* b, int pointCount)
+{
+	// The coordinates are clamped to 15 bits, so the differences fit in 16 bits and dx * dx + dy * dy fits in 31 bits.
+	float distance = 0.0f;
+	int i = 0;
+
+#ifdef GESTURE_SSE2
+	__m128 distances = _mm_setzero_ps();
+	for (; i + 4 <= pointCount; i += 4)
+	{
+		__m128i difference = _mm_sub_epi16(_mm_loadu_si128((const __m128i*)(b + 2 * i)), _mm_loadu_si128((const __m128i*)(a + 2 * i)));
+		__m128i squaredDistances = _mm_madd_epi16(difference, difference);
+		distances = _mm_add_ps(distances, _mm_sqrt_ps(_mm_cvtepi32_ps(squaredDistances)));
+	}
+	distance = HorizontalSum(distances);
+#endif
+
+	for (; i < pointCount; ++i)
+	{
+		int dx = b[2 * i] - a[2 * i];
+		int dy = b[2 * i + 1] - a[2 * i + 1];
+		distance += std::sqrt((float)(dx * dx + dy * dy));
+	}
+
+	return distance / (pointCount * QUANTIZATION_SCALE);
+}
+
+void NormalizeInterleavedStrokes(float* x, float* y, int pointCount, int size)
+{
+	float centroidX[STROKE_LANES];
+	float centroidY[STROKE_LANES];
+	float cosAngles[STROKE_LANES];
+	float sinAngles[STROKE_LANES];
+
+#ifdef GESTURE_SSE2
+	const __m128 count = _mm_set1_ps((float)pointCount);
+
+	// Find the centroids.
+	__m128 sumX = _mm_setzero_ps();
+	__m128 sumY = _mm_setzero_ps();
+	for (int i = 0; i < pointCount; ++i)
+	{
+		sumX = _mm_add_ps(sumX, _mm_loadu_ps(x + i * STROKE_LANES));
+		sumY = _mm_add_ps(sumY, _mm_loadu_ps(y + i * STROKE_LANES));
+	}
+
+	const __m128 centerX = _mm_div_ps(sumX, count);
+	const __m128 centerY = _mm_div_ps(sumY, count);
+	_mm_storeu_ps(centroidX, centerX);
+	_mm_storeu_ps(centroidY, centerY);
+
+	// The indicative angles are the only scalar part.
+	for (int k = 0; k < STROKE_LANES; ++k)
+	{
+		const float angle = -atan2(centroidY[k] - y[k], centroidX[k] - x[k]);
+		cosAngles[k] = std::cos(angle);
+		sinAngles[k] = std::sin(angle);
+	}
+
+	// Rotate around the centroids and find the bounding boxes.
+	const __m128 cosAngle = _mm_loadu_ps(cosAngles);
+	const __m128 sinAngle = _mm_loadu_ps(sinAngles);
+	__m128 minX = _mm_set1_ps(std::numeric_limits<float>::infinity());
+	__m128 minY = minX;
+	__m128 maxX = _mm_set1_ps(-std::numeric_limits<float>::infinity());
+	__m128 maxY = maxX;
+
+	for (int i = 0; i < pointCount; ++i)
+	{
+		const __m128 dx = _mm_sub_ps(_mm_loadu_ps(x + i * STROKE_LANES), centerX);
+		const __m128 dy = _mm_sub_ps(_mm_loadu_ps(y + i * STROKE_LANES), centerY);
+		const __m128 rotatedX = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(dx, cosAngle), _mm_mul_ps(dy, sinAngle)), centerX);
+		const __m128 rotatedY = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, sinAngle), _mm_mul_ps(dy, cosAngle)), centerY);
+
+		_mm_storeu_ps(x + i * STROKE_LANES, rotatedX);
+		_mm_storeu_ps(y + i * STROKE_LANES, rotatedY);
+
+		minX = _mm_min_ps(minX, rotatedX);
+		minY = _mm_min_ps(minY, rotatedY);
+		maxX = _mm_max_ps(maxX, rotatedX);
+		maxY = _mm_max_ps(maxY, rotatedY);
+	}
+
+	// Scale the bounding boxes and find the new centroids.
+	const __m128 sizes = _mm_set1_ps((float)size);
+	const __m128 width = _mm_sub_ps(maxX, minX);
+	const __m128 height = _mm_sub_ps(maxY, minY);
+	sumX = _mm_setzero_ps();
+	sumY = _mm_setzero_ps();
+
+	for (int i = 0; i < pointCount; ++i)
+	{
+		const __m128 scaledX = _mm_div_ps(_mm_mul_ps(_mm_loadu_ps(x + i * STROKE_LANES), sizes), width);
+		const __m128 scaledY = _mm_div_ps(_mm_mul_ps(_mm_loadu_ps(y + i * STROKE_LANES), sizes), height);
+
+		_mm_storeu_ps(x + i * STROKE_LANES, scaledX);
+		_mm_storeu_ps(y + i * STROKE_LANES, scaledY);
+
+		sumX = _mm_add_ps(sumX, scaledX);
+		sumY = _mm_add_ps(sumY, scaledY);
+	}
+
+	// Translate the centroids to the origin.
+	const __m128 displacementX = _mm_sub_ps(_mm_setzero_ps(), _mm_div_ps(sumX, count));
+	const __m128 displacementY = _mm_sub_ps(_mm_setzero_ps(), _mm_div_ps(sumY, count));
+
+	for (int i = 0; i < pointCount; ++i)
+	{
+		_mm_storeu_ps(x + i * STROKE_LANES, _mm_add_ps(_mm_loadu_ps(x + i * STROKE_LANES), displacementX));
+		_mm_storeu_ps(y + i * STROKE_LANES, _mm_add_ps(_mm_loadu_ps(y + i * STROKE_LANES), displacementY));
+	}
+#else
+	for (int k = 0; k < STROKE_LANES; ++k)
+	{
+		float sumX = 0.0f;
+		float sumY = 0.0f;
+		for (int i = 0; i < pointCount; ++i)
+		{
+			sumX += x[i * STROKE_LANES + k];
+			sumY += y[i * STROKE_LANES + k];
+		}
+
+		centroidX[k] = sumX / pointCount;
+		centroidY[k] = sumY / pointCount;
+
+		const float angle = -atan2(centroidY[k] - y[k], centroidX[k] - x[k]);
+		cosAngles[k] = std::cos(angle);
+		sinAngles[k] = std::sin(angle);
+
+		float minX = std::numeric_limits<float>::infinity();
+		float minY = std::numeric_limits<float>::infinity();
+		float maxX = -std::numeric_limits<float>::infinity();
+		float maxY = -std::numeric_limits<float>::infinity();
+		for (int i = 0; i < pointCount; ++i)
+		{
+			const float dx = x[i * STROKE_LANES + k] - centroidX[k];
+			const float dy = y[i * STROKE_LANES + k] - centroidY[k];
+			const float rotatedX = dx * cosAngles[k] - dy * sinAngles[k] + centroidX[k];
+			const float rotatedY = dx * sinAngles[k] + dy * cosAngles[k] + centroidY[k];
+
+			x[i * STROKE_LANES + k] = rotatedX;
+			y[i * STROKE_LANES + k] = rotatedY;
+
+			minX = std::fmin(minX, rotatedX);
+			minY = std::fmin(minY, rotatedY);
+			maxX = std::fmax(maxX, rotatedX);
+			maxY = std::fmax(maxY, rotatedY);
+		}
+
+		const float width = maxX - minX;
+		const float height = maxY - minY;
+		sumX = 0.0f;
+		sumY = 0.0f;
+		for (int i = 0; i < pointCount; ++i)
+		{
+			x[i * STROKE_LANES + k] = x[i * STROKE_LANES + k] * size / width;
+			y[i * STROKE_LANES + k] = y[i * STROKE_LANES + k] * size / height;
+
+			sumX += x[i * STROKE_LANES + k];
+			sumY += y[i * STROKE_LANES + k];
+		}
+
+		const float displacementX = 0.0f - sumX / pointCount;
+		const float displacementY = 0.0f - sumY / pointCount;
+		for (int i = 0; i < pointCount; ++i)
+		{
+			x[i * STROKE_LANES + k] += displacementX;
+			y[i * STROKE_LANES + k] += displacementY;
+		}
+	}
+#endif
+}
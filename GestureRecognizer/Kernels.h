@@ -0,0 +1,48 @@
+// Kernels.h
+// Programmer: Khoi Ho
+
+#pragma once
+
+#include <cstdint>
+
+// SSE2 is available on every x64 CPU and enabled by default on x86 since Visual Studio 2012.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GESTURE_SSE2
+#endif
+
+// The coordinates of the quantized templates are stored in fixed point with this many fractional bits.
+const int QUANTIZATION_BITS = 6;
+const float QUANTIZATION_SCALE = (float)(1 << QUANTIZATION_BITS);
+
+// The number of angles evaluated at once by GetPathDistancesAtAngles, one per SIMD lane.
+const int ANGLE_LANES = 4;
+
+// The number of templates interleaved by GetPathDistancesToInterleavedTemplates, which fills 2 SSE2 registers.
+const int TEMPLATE_LANES = 8;
+
+// The number of strokes normalized at once by NormalizeInterleavedStrokes, one per SIMD lane.
+const int STROKE_LANES = 4;
+
+// Rotates the points by an angle around a center. The points are given as separate arrays of x and y coordinates.
+void RotatePoints(const float* x, const float* y, int pointCount, float angle, float centerX, float centerY, float* rotatedX, float* rotatedY);
+
+// Returns the average distance between respective points.
+float GetPathDistance(const float* ax, const float* ay, const float* bx, const float* by, int pointCount);
+
+// Rotates the points by ANGLE_LANES angles around a center and returns the average distance to the template points at each angle, without storing the rotated points.
+void GetPathDistancesAtAngles(const float* x, const float* y, int pointCount, const float* angles, float centerX, float centerY, const float* templateX, const float* templateY, float* distances);
+
+// Rotates the points around a center by a different angle for each of TEMPLATE_LANES templates, and returns the average distance to each template.
+// The templates are interleaved: point i of template k is at templateX[i * TEMPLATE_LANES + k], so each template gets its own lane and no horizontal sum is needed.
+void GetPathDistancesToInterleavedTemplates(const float* x, const float* y, int pointCount, const float* angles, float centerX, float centerY, const float* templateX, const float* templateY, float* distances);
+
+// Converts the points to fixed point, stored as x0, y0, x1, y1...
+void QuantizePoints(const float* x, const float* y, int pointCount, int16_t* quantizedPoints);
+
+// Returns the average distance between respective quantized points, in the same unit as the unquantized points.
+float GetQuantizedPathDistance(const int16_t* a, const int16_t* b, int pointCount);
+
+// Rotates STROKE_LANES resampled strokes by their indicative angle, scales them to a square of the specified size and translates their centroid to the origin, in place.
+// The strokes are interleaved: point i of stroke k is at x[i * STROKE_LANES + k]. The operations are the same as in Stroke::Normalize, so are the results,
+// unless the compiler contracts the multiplications and additions of Stroke into fused multiply-adds (e.g. GCC with -ffp-contract=fast).
+void NormalizeInterleavedStrokes(float* x, float* y, int pointCount, int size);
@@ -0,0 +1,144 @@
+#include "LshIndex.h"
+#include <algorithm>
+#include <random>
+#include "PerfCounters.h"
+#include "Profiler.h"
+#include "Tracer.h"
+#include "WorkCounters.h"
+
+LshIndex::LshIndex(int tableCount, int bitCount, unsigned int seed):tableCount(tableCount), bitCount(bitCount), seed(seed)
+{
+	if (bitCount < 1 || bitCount > 32)
+		throw std::exception("Cannot create the index: The number of bits per table must be between 1 and 32.");
+}
+
+void LshIndex::Build(const TemplateBank& newBank)
+{
+	TRACE_SCOPE("BuildLshIndex", "preprocessing");
+
+	bank = &newBank;
+
+	const int pointCount = bank->GetPointCount();
+
+	// The preprocessed strokes are centered at the origin, so the hyperplanes go through the origin.
+	std::mt19937 generator(seed);
+	std::normal_distribution<float> distribution(0.0f, 1.0f);
+
+	hyperplanes.resize(tableCount * bitCount * 2 * pointCount);
+	for (float& coefficient : hyperplanes)
+		coefficient = distribution(generator);
+
+	tables.assign(tableCount, std::unordered_map<uint32_t, std::vector<int>>());
+	for (int i = 0; i < bank->GetTemplateCount(); ++i)
+	{
+		for (int table = 0; table < tableCount; ++table)
+			tables[table][GetHash(table, bank->GetX(i), bank->GetY(i))].push_back(i);
+	}
+}
+
+int LshIndex::GetTemplateCount() const
+{
+	return bank != nullptr ? bank->GetTemplateCount() : 0;
+}
+
+int LshIndex::GetPointCount() const
+{
+	return bank != nullptr ? bank->GetPointCount() : 0;
+}
+
+int LshIndex::GetSize() const
+{
+	return bank != nullptr ? bank->GetSize() : 0;
+}
+
+const std::string& LshIndex::GetName(int index) const
+{
+	if (bank == nullptr)
+		throw std::exception("Cannot get the name of the template: The index is not built.");
+
+	return bank->GetName(index);
+}
+
+size_t LshIndex::GetMemoryUsage() const
+{
+	size_t memoryUsage = hyperplanes.size() * sizeof(float);
+
+	for (const std::unordered_map<uint32_t, std::vector<int>>& buckets : tables)
+	{
+		for (const std::pair<const uint32_t, std::vector<int>>& bucket : buckets)
+			memoryUsage += sizeof(bucket) + bucket.second.size() * sizeof(int);
+	}
+
+	return memoryUsage;
+}
+
+uint32_t LshIndex::GetHash(int table, const float* x, const float* y) const
+{
+	const int pointCount = bank->GetPointCount();
+
+	uint32_t hash = 0;
+	for (int bit = 0; bit < bitCount; ++bit)
+	{
+		const float* normal = hyperplanes.data() + (table * bitCount + bit) * 2 * pointCount;
+
+		float dotProduct = 0.0f;
+		for (int i = 0; i < pointCount; ++i)
+			dotProduct += normal[i] * x[i] + normal[pointCount + i] * y[i];
+
+		if (dotProduct >= 0.0f)
+			hash |= 1u << bit;
+	}
+
+	return hash;
+}
+
+void LshIndex::Recognize(const Stroke& candidate, int& matchingIndex, float& score, std::pmr::memory_resource* resource) const
+{
+	if (bank == nullptr)
+		throw std::exception("Cannot recognize the stroke: The index is not built.");
+
+	const int pointCount = bank->GetPointCount();
+
+	if (candidate.GetPointCount() != pointCount)
+		throw std::exception("Cannot recognize the stroke: The stroke must be resampled into as many points as the templates.");
+
+	std::pmr::vector<float> candidateX(pointCount, resource);
+	std::pmr::vector<float> candidateY(pointCount, resource);
+	for (int i = 0; i < pointCount; ++i)
+	{
+		candidateX[i] = candidate.GetPoint(i).x;
+		candidateY[i] = candidate.GetPoint(i).y;
+	}
+
+	// Gather the templates of the buckets of the candidate, without duplicates.
+	std::pmr::vector<int> indices(resource);
+	for (int table = 0; table < tableCount; ++table)
+	{
+		std::unordered_map<uint32_t, std::vector<int>>::const_iterator bucket = tables[table].find(GetHash(table, candidateX.data(), candidateY.data()));
+		if (bucket != tables[table].end())
+			indices.insert(indices.end(), bucket->second.begin(), bucket->second.end());
+	}
+
+	std::sort(indices.begin(), indices.end());
+	indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+
+	// Without any bucket, the recognition compares the candidate with no template. It is still recorded, as the bank would, so that the averages cover every query.
+	if (indices.empty())
+	{
+		PROFILE_STAGE(ProfileStage::Recognize);
+		TRACE_SCOPE("Recognize", "recognition");
+		PERF_SCOPE(PerfStage::Recognize);
+
+		WorkCounters& workCounters = WorkCounters::GetThreadCounters();
+		const WorkCounters workCountersBefore = workCounters;
+		workCounters.templatesSkipped += bank->GetTemplateCount();
+
+		matchingIndex = -1;
+		score = 0.0f;
+
+		WorkCounters::AddRecognition(workCounters - workCountersBefore);
+		return;
+	}
+
+	bank->RecognizeAmong(candidate, indices.data(), indices.size(), matchingIndex, score, resource);
+}
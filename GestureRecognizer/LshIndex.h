@@ -0,0 +1,57 @@
+// LshIndex.h
+// Programmer: Khoi Ho
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Stroke.h"
+#include "TemplateBank.h"
+
+// An approximate index over the templates of a bank, which hashes the preprocessed strokes with random projections (locality-sensitive hashing).
+// Each template is seen as a vector of 2 * pointCount coordinates, and each bit of its hash tells on which side of a random hyperplane it lies.
+// Only the templates that share a bucket with the candidate in at least one table are compared with the search for the best angle.
+// More tables find more of the true matches, more bits per table make the buckets smaller and the recognition faster.
+class LshIndex
+{
+public:
+	LshIndex(int tableCount = 8, int bitCount = 12, unsigned int seed = 12345);
+
+	// Hashes the templates of the bank. The bank is not copied, so it must outlive the index and must not be rebuilt in between.
+	void Build(const TemplateBank& bank);
+
+	// Return 0 until the index is built.
+	int GetTemplateCount() const;
+	int GetPointCount() const;
+	int GetSize() const;
+
+	// Returns the name of a template. The index must be built.
+	const std::string& GetName(int index) const;
+
+	// Returns the number of bytes used by the hyperplanes and the buckets.
+	size_t GetMemoryUsage() const;
+
+	// Finds the template that matches the preprocessed candidate among the templates in its buckets and returns its index and the score, or -1 and a score of 0 if the buckets are empty.
+	// The index must be built. The temporary buffers are allocated from the memory resource.
+	void Recognize(const Stroke& candidate, int& matchingIndex, float& score, std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const;
+
+private:
+	// Returns the bucket of the coordinates in a table.
+	uint32_t GetHash(int table, const float* x, const float* y) const;
+
+	int tableCount;
+	int bitCount;
+	unsigned int seed;
+
+	const TemplateBank* bank = nullptr;
+
+	// The normal of hyperplane b of table t starts at hyperplanes[(t * bitCount + b) * 2 * pointCount], with the x coefficients before the y coefficients.
+	std::vector<float> hyperplanes;
+
+	// The indices of the templates in each bucket of each table.
+	std::vector<std::unordered_map<uint32_t, std::vector<int>>> tables;
+};
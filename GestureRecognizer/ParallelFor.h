@@ -0,0 +1,51 @@
+// ParallelFor.h
+// Programmer: Khoi Ho
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <vector>
+
+// Calls function(i) for every i from 0 to count - 1, spread over the hardware threads. The calls must be independent of each other.
+// The indices are handed out one at a time, so that slow calls do not hold up the other threads.
+// If a call throws, the threads stop taking indices, and one of the exceptions is rethrown on the calling thread once they are done, as in a serial loop.
+template <typename Function>
+void ParallelFor(int count, Function function)
+{
+	const int threadCount = std::min<int>(std::max(1u, std::thread::hardware_concurrency()), count);
+
+	std::atomic<int> nextIndex(0);
+	std::vector<std::exception_ptr> exceptions(std::max(threadCount, 1));
+	auto work = [&](int thread)
+	{
+		try
+		{
+			for (int i = nextIndex++; i < count; i = nextIndex++)
+				function(i);
+		}
+		catch (...)
+		{
+			exceptions[thread] = std::current_exception();
+			nextIndex = count;
+		}
+	};
+
+	// The calling thread works too.
+	std::vector<std::thread> threads;
+	for (int i = 1; i < threadCount; ++i)
+		threads.emplace_back(work, i);
+
+	work(0);
+
+	for (std::thread& thread : threads)
+		thread.join();
+
+	for (const std::exception_ptr& exception : exceptions)
+	{
+		if (exception)
+			std::rethrow_exception(exception);
+	}
+}
@@ -0,0 +1,237 @@
+#include "PerfCounters.h"
+#include <atomic>
+#include <iomanip>
+
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	const int EVENT_COUNT = (int)PerfEvent::Count;
+
+	std::atomic<uint64_t> callCounts[(int)PerfStage::Count];
+	std::atomic<uint64_t> countedCallCounts[(int)PerfStage::Count];
+	std::atomic<uint64_t> totals[(int)PerfStage::Count][EVENT_COUNT];
+
+	const char* STAGE_NAMES[(int)PerfStage::Count] =
+	{
+		"Recognize",
+		"PreprocessTemplate"
+	};
+
+	const char* EVENT_NAMES[EVENT_COUNT] =
+	{
+		"Cycles",
+		"Instructions",
+		"L1D misses",
+		"LLC misses",
+		"Branch misses"
+	};
+
+#ifdef __linux__
+	// Opens a counter of the calling thread on any CPU. Returns -1 if the counter is not supported or not allowed.
+	int OpenCounter(uint32_t type, uint64_t config, int groupFd)
+	{
+		perf_event_attr attributes;
+		std::memset(&attributes, 0, sizeof(attributes));
+		attributes.size = sizeof(attributes);
+		attributes.type = type;
+		attributes.config = config;
+		attributes.exclude_kernel = 1;
+		attributes.exclude_hv = 1;
+		attributes.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+		return (int)syscall(SYS_perf_event_open, &attributes, 0, -1, groupFd, 0);
+	}
+
+	// The counters of a thread. They are opened as one group, so that all of them are read with a single system call.
+	struct ThreadCounterGroup
+	{
+		int fds[EVENT_COUNT];
+
+		// The position of each event in the values read from the group, or -1 if the event could not be opened.
+		int positions[EVENT_COUNT];
+
+		int leaderFd;
+		int openedCount;
+
+		ThreadCounterGroup() : leaderFd(-1), openedCount(0)
+		{
+			const uint64_t CACHE_READ_MISS = (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+
+			const uint32_t types[EVENT_COUNT] = { PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE };
+			const uint64_t configs[EVENT_COUNT] =
+			{
+				PERF_COUNT_HW_CPU_CYCLES,
+				PERF_COUNT_HW_INSTRUCTIONS,
+				PERF_COUNT_HW_CACHE_L1D | CACHE_READ_MISS,
+				PERF_COUNT_HW_CACHE_LL | CACHE_READ_MISS,
+				PERF_COUNT_HW_BRANCH_MISSES
+			};
+
+			for (int i = 0; i < EVENT_COUNT; ++i)
+			{
+				fds[i] = OpenCounter(types[i], configs[i], leaderFd);
+				positions[i] = -1;
+
+				if (fds[i] < 0)
+					continue;
+
+				if (leaderFd < 0)
+					leaderFd = fds[i];
+
+				positions[i] = openedCount++;
+			}
+		}
+
+		~ThreadCounterGroup()
+		{
+			for (int i = 0; i < EVENT_COUNT; ++i)
+				if (fds[i] >= 0)
+					close(fds[i]);
+		}
+	};
+
+	ThreadCounterGroup& GetThreadCounterGroup()
+	{
+		thread_local ThreadCounterGroup threadCounterGroup;
+		return threadCounterGroup;
+	}
+#endif
+}
+
+bool PerfCounters::IsAvailable()
+{
+#ifdef __linux__
+	return GetThreadCounterGroup().leaderFd >= 0;
+#else
+	return false;
+#endif
+}
+
+uint64_t PerfCounters::Read(uint64_t values[(int)PerfEvent::Count])
+{
+	for (int i = 0; i < EVENT_COUNT; ++i)
+		values[i] = 0;
+
+#ifdef __linux__
+	ThreadCounterGroup& group = GetThreadCounterGroup();
+	if (group.leaderFd < 0)
+		return 0;
+
+	// The group is read as the number of counters, the time enabled, the time running, then the values.
+	uint64_t buffer[3 + EVENT_COUNT];
+	if (read(group.leaderFd, buffer, sizeof(buffer)) < (ssize_t)(3 * sizeof(uint64_t)))
+		return 0;
+
+	const uint64_t timeEnabled = buffer[1];
+	const uint64_t timeRunning = buffer[2];
+
+	// The group was never scheduled, so the values mean nothing.
+	if (timeRunning == 0)
+		return 0;
+
+	for (int i = 0; i < EVENT_COUNT; ++i)
+	{
+		if (group.positions[i] >= 0 && (uint64_t)group.positions[i] < buffer[0])
+		{
+			const uint64_t value = buffer[3 + group.positions[i]];
+			values[i] = timeRunning < timeEnabled ? (uint64_t)((double)value * timeEnabled / timeRunning) : value;
+		}
+	}
+
+	return timeRunning;
+#else
+	return 0;
+#endif
+}
+
+void PerfCounters::Record(PerfStage stage, const uint64_t values[(int)PerfEvent::Count], bool isCounted)
+{
+	callCounts[(int)stage].fetch_add(1, std::memory_order_relaxed);
+
+	if (!isCounted)
+		return;
+
+	countedCallCounts[(int)stage].fetch_add(1, std::memory_order_relaxed);
+
+	for (int i = 0; i < EVENT_COUNT; ++i)
+		totals[(int)stage][i].fetch_add(values[i], std::memory_order_relaxed);
+}
+
+uint64_t PerfCounters::GetCallCount(PerfStage stage)
+{
+	return callCounts[(int)stage].load(std::memory_order_relaxed);
+}
+
+uint64_t PerfCounters::GetCountedCallCount(PerfStage stage)
+{
+	return countedCallCounts[(int)stage].load(std::memory_order_relaxed);
+}
+
+uint64_t PerfCounters::GetTotal(PerfStage stage, PerfEvent event)
+{
+	return totals[(int)stage][(int)event].load(std::memory_order_relaxed);
+}
+
+void PerfCounters::Reset()
+{
+	for (int stage = 0; stage < (int)PerfStage::Count; ++stage)
+	{
+		callCounts[stage].store(0, std::memory_order_relaxed);
+		countedCallCounts[stage].store(0, std::memory_order_relaxed);
+
+		for (int i = 0; i < EVENT_COUNT; ++i)
+			totals[stage][i].store(0, std::memory_order_relaxed);
+	}
+}
+
+void PerfCounters::Dump(std::ostream& out)
+{
+	if (!IsAvailable())
+	{
+		out << "Hardware performance counters are not available." << std::endl;
+		return;
+	}
+
+	std::ios::fmtflags flags = out.flags();
+	std::streamsize precision = out.precision();
+
+	out << std::left << std::setw(20) << "Stage (per call)" << std::right << std::setw(10) << "Calls" << std::setw(10) << "Counted";
+	for (int i = 0; i < EVENT_COUNT; ++i)
+		out << std::setw(16) << EVENT_NAMES[i];
+	out << std::setw(8) << "IPC" << std::endl;
+
+	out << std::fixed << std::setprecision(1);
+	for (int stage = 0; stage < (int)PerfStage::Count; ++stage)
+	{
+		const uint64_t callCount = GetCallCount((PerfStage)stage);
+		if (callCount == 0)
+			continue;
+
+		const uint64_t countedCallCount = GetCountedCallCount((PerfStage)stage);
+
+		out << std::left << std::setw(20) << STAGE_NAMES[stage] << std::right << std::setw(10) << callCount << std::setw(10) << countedCallCount;
+
+		// The counters could not be scheduled during any call, e.g. because too many events were competing for the hardware counters.
+		if (countedCallCount == 0)
+		{
+			out << std::setw(16) << "not counted" << std::endl;
+			continue;
+		}
+
+		for (int i = 0; i < EVENT_COUNT; ++i)
+			out << std::setw(16) << (double)GetTotal((PerfStage)stage, (PerfEvent)i) / countedCallCount;
+
+		const uint64_t cycles = GetTotal((PerfStage)stage, PerfEvent::Cycles);
+		const uint64_t instructions = GetTotal((PerfStage)stage, PerfEvent::Instructions);
+		out << std::setw(8) << std::setprecision(2) << (cycles > 0 ? (double)instructions / cycles : 0.0) << std::setprecision(1) << std::endl;
+	}
+
+	out.flags(flags);
+	out.precision(precision);
+}
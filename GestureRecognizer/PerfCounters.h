@@ -0,0 +1,90 @@
+// PerfCounters.h
+// Programmer: Khoi Ho
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+
+// The stages measured with the hardware performance counters.
+enum class PerfStage
+{
+	Recognize,
+	PreprocessTemplate,
+	Count
+};
+
+// The hardware events counted for each stage.
+enum class PerfEvent
+{
+	Cycles,
+	Instructions,
+	L1DataMisses,
+	LastLevelCacheMisses,
+	BranchMisses,
+	Count
+};
+
+// Samples the hardware performance counters around each stage with perf_event_open and sums them per stage.
+// Only available on Linux. The instrumentation is only compiled in when GESTURE_PERF_COUNTERS is defined. Otherwise, PERF_SCOPE expands to nothing.
+class PerfCounters
+{
+public:
+	// Returns true if the counters can be opened on the calling thread (e.g. perf_event_paranoid allows it).
+	static bool IsAvailable();
+
+	// Reads the current value of each counter of the calling thread. The counters that cannot be opened are set to 0.
+	// If the kernel multiplexed the counters with other events, the values are scaled by the time enabled over the time running.
+	// Returns the time in nanoseconds during which the counters were running, which does not change while they cannot be scheduled.
+	static uint64_t Read(uint64_t values[(int)PerfEvent::Count]);
+
+	// Adds the counts of one call to the totals of a stage. If isCounted is false, the counters did not run during the call, so only the call is counted.
+	static void Record(PerfStage stage, const uint64_t values[(int)PerfEvent::Count], bool isCounted);
+
+	// Returns the number of calls recorded for a stage.
+	static uint64_t GetCallCount(PerfStage stage);
+
+	// Returns the number of calls of a stage during which the counters ran.
+	static uint64_t GetCountedCallCount(PerfStage stage);
+
+	// Returns the sum of an event over the counted calls of a stage.
+	static uint64_t GetTotal(PerfStage stage, PerfEvent event);
+
+	// Clears the totals.
+	static void Reset();
+
+	// Writes the average of each event per counted call for each stage, or "not counted" if the counters never ran during its calls.
+	static void Dump(std::ostream& out);
+};
+
+// Records the counts between its construction and its destruction.
+class PerfScope
+{
+public:
+	PerfScope(PerfStage stage) : stage(stage)
+	{
+		startTimeRunning = PerfCounters::Read(start);
+	}
+
+	~PerfScope()
+	{
+		uint64_t end[(int)PerfEvent::Count];
+		const uint64_t endTimeRunning = PerfCounters::Read(end);
+
+		for (int i = 0; i < (int)PerfEvent::Count; ++i)
+			end[i] -= start[i];
+
+		PerfCounters::Record(stage, end, endTimeRunning > startTimeRunning);
+	}
+
+private:
+	PerfStage stage;
+	uint64_t start[(int)PerfEvent::Count];
+	uint64_t startTimeRunning;
+};
+
+#if defined(GESTURE_PERF_COUNTERS) && defined(__linux__)
+#define PERF_SCOPE(stage) PerfScope perfScope(stage)
+#else
+#define PERF_SCOPE(stage)
+#endif
@@ -0,0 +1,124 @@
+#include "Profiler.h"
+#include <atomic>
+#include <iomanip>
+
+namespace
+{
+	std::atomic<uint64_t> histograms[(int)ProfileStage::Count][Profiler::BUCKET_COUNT];
+
+	const char* STAGE_NAMES[(int)ProfileStage::Count] =
+	{
+		"Resample",
+		"RotateBy",
+		"ScaleTo",
+		"TranslateTo",
+		"AngleSearch",
+		"Recognize"
+	};
+
+	// Returns the index of the bucket that holds a duration.
+	int GetBucketIndex(uint64_t value)
+	{
+		if (value < Profiler::SUB_BUCKET_COUNT)
+			return (int)value;
+
+		// Find the most significant bit.
+		int msb = 0;
+		for (int shift = 32; shift > 0; shift /= 2)
+		{
+			if (value >> (msb + shift))
+				msb += shift;
+		}
+
+		const int shift = msb - Profiler::SUB_BUCKET_BITS;
+		const int subBucket = (int)(value >> shift) & (Profiler::SUB_BUCKET_COUNT - 1);
+		return (shift + 1) * Profiler::SUB_BUCKET_COUNT + subBucket;
+	}
+
+	// Returns the middle of the range of durations held by a bucket.
+	double GetBucketValue(int index)
+	{
+		if (index < Profiler::SUB_BUCKET_COUNT)
+			return index;
+
+		const int shift = index / Profiler::SUB_BUCKET_COUNT - 1;
+		const int subBucket = index % Profiler::SUB_BUCKET_COUNT;
+		const double lowerBound = (double)((uint64_t)(Profiler::SUB_BUCKET_COUNT + subBucket) << shift);
+		return lowerBound + 0.5 * (double)((uint64_t)1 << shift);
+	}
+}
+
+void Profiler::Record(ProfileStage stage, uint64_t nanoseconds)
+{
+	histograms[(int)stage][GetBucketIndex(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t Profiler::GetCount(ProfileStage stage)
+{
+	uint64_t count = 0;
+	for (const std::atomic<uint64_t>& bucket : histograms[(int)stage])
+		count += bucket.load(std::memory_order_relaxed);
+	return count;
+}
+
+double Profiler::GetPercentile(ProfileStage stage, double percentile)
+{
+	const uint64_t count = GetCount(stage);
+	if (count == 0)
+		return 0.0;
+
+	// The rank of the requested duration, starting from 1.
+	uint64_t rank = (uint64_t)(percentile * count + 0.5);
+	if (rank < 1)
+		rank = 1;
+	else if (rank > count)
+		rank = count;
+
+	uint64_t cumulativeCount = 0;
+	for (int i = 0; i < BUCKET_COUNT; ++i)
+	{
+		cumulativeCount += histograms[(int)stage][i].load(std::memory_order_relaxed);
+		if (cumulativeCount >= rank)
+			return GetBucketValue(i);
+	}
+
+	return GetBucketValue(BUCKET_COUNT - 1);
+}
+
+void Profiler::Reset()
+{
+	for (auto& histogram : histograms)
+		for (std::atomic<uint64_t>& bucket : histogram)
+			bucket.store(0, std::memory_order_relaxed);
+}
+
+void Profiler::Dump(std::ostream& out)
+{
+	std::ios::fmtflags flags = out.flags();
+	std::streamsize precision = out.precision();
+
+	out << std::left << std::setw(14) << "Stage" << std::right
+		<< std::setw(12) << "Count"
+		<< std::setw(12) << "p50 (us)"
+		<< std::setw(12) << "p95 (us)"
+		<< std::setw(12) << "p99 (us)" << std::endl;
+
+	out << std::fixed << std::setprecision(2);
+	for (int i = 0; i < (int)ProfileStage::Count; ++i)
+	{
+		ProfileStage stage = (ProfileStage)i;
+		out << std::left << std::setw(14) << GetStageName(stage) << std::right
+			<< std::setw(12) << GetCount(stage)
+			<< std::setw(12) << GetPercentile(stage, 0.50) / 1000.0
+			<< std::setw(12) << GetPercentile(stage, 0.95) / 1000.0
+			<< std::setw(12) << GetPercentile(stage, 0.99) / 1000.0 << std::endl;
+	}
+
+	out.flags(flags);
+	out.precision(precision);
+}
+
+const char* Profiler::GetStageName(ProfileStage stage)
+{
+	return STAGE_NAMES[(int)stage];
+}
@@ -0,0 +1,72 @@
+// Profiler.h
+// Programmer: Khoi Ho
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+// The stages of the recognition pipeline that can be timed.
+enum class ProfileStage
+{
+	Resample,
+	RotateBy,
+	ScaleTo,
+	TranslateTo,
+	AngleSearch,
+	Recognize,
+	Count
+};
+
+// Records the duration of each stage into a lock-free histogram.
+// The instrumentation is only compiled in when GESTURE_PROFILING is defined. Otherwise, PROFILE_STAGE expands to nothing.
+class Profiler
+{
+public:
+	// Each power of 2 is split into 2^SUB_BUCKET_BITS buckets, so the relative error of a percentile is at most 1/8.
+	static const int SUB_BUCKET_BITS = 3;
+	static const int SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+	static const int BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+	// Adds a duration (in nanoseconds) to the histogram of a stage. Safe to call from any thread.
+	static void Record(ProfileStage stage, uint64_t nanoseconds);
+
+	// Returns the number of durations recorded for a stage.
+	static uint64_t GetCount(ProfileStage stage);
+
+	// Returns the percentile (between 0 and 1) of the durations of a stage in nanoseconds.
+	static double GetPercentile(ProfileStage stage, double percentile);
+
+	// Clears all the histograms.
+	static void Reset();
+
+	// Writes the count, p50, p95 and p99 of each stage.
+	static void Dump(std::ostream& out);
+
+	// Returns the name of a stage.
+	static const char* GetStageName(ProfileStage stage);
+};
+
+// Records the time between its construction and its destruction.
+class ProfileScope
+{
+public:
+	ProfileScope(ProfileStage stage) : stage(stage), start(std::chrono::steady_clock::now()) {}
+
+	~ProfileScope()
+	{
+		std::chrono::steady_clock::duration duration = std::chrono::steady_clock::now() - start;
+		Profiler::Record(stage, std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+	}
+
+private:
+	ProfileStage stage;
+	std::chrono::steady_clock::time_point start;
+};
+
+#ifdef GESTURE_PROFILING
+#define PROFILE_STAGE(stage) ProfileScope profileScope(stage)
+#else
+#define PROFILE_STAGE(stage)
+#endif
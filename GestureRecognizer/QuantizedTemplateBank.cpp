@@ -0,0 +1,112 @@
+#include "QuantizedTemplateBank.h"
+#include <limits>
+#include "AngleSearch.h"
+#include "Kernels.h"
+#include "PerfCounters.h"
+#include "Profiler.h"
+#include "Tracer.h"
+#include "WorkCounters.h"
+
+void QuantizedTemplateBank::Build(const TemplateBank& bank)
+{
+	const int templateCount = bank.GetTemplateCount();
+
+	pointCount = bank.GetPointCount();
+	size = bank.GetSize();
+
+	names.clear();
+	names.reserve(templateCount);
+
+	points.assign(2 * templateCount * pointCount, 0);
+
+	for (int i = 0; i < templateCount; ++i)
+	{
+		names.push_back(bank.GetName(i));
+		QuantizePoints(bank.GetX(i), bank.GetY(i), pointCount, points.data() + 2 * i * pointCount);
+	}
+}
+
+int QuantizedTemplateBank::GetTemplateCount() const
+{
+	return names.size();
+}
+
+int QuantizedTemplateBank::GetPointCount() const
+{
+	return pointCount;
+}
+
+int QuantizedTemplateBank::GetSize() const
+{
+	return size;
+}
+
+const std::string& QuantizedTemplateBank::GetName(int index) const
+{
+	return names[index];
+}
+
+size_t QuantizedTemplateBank::GetMemoryUsage() const
+{
+	return points.size() * sizeof(int16_t);
+}
+
+void QuantizedTemplateBank::Recognize(const Stroke& candidate, int& matchingIndex, float& score, std::pmr::memory_resource* resource) const
+{
+	PROFILE_STAGE(ProfileStage::Recognize);
+	TRACE_SCOPE("Recognize", "recognition");
+	PERF_SCOPE(PerfStage::Recognize);
+
+	if (candidate.GetPointCount() != pointCount)
+		throw std::exception("Cannot recognize the stroke: The stroke must be resampled into as many points as the templates.");
+
+	// Remember the work done so far, so that the work of this recognition can be measured.
+	WorkCounters& workCounters = WorkCounters::GetThreadCounters();
+	const WorkCounters workCountersBefore = workCounters;
+
+	// The candidate is rotated in floating point, then quantized before being compared.
+	std::pmr::vector<float> candidateX(pointCount, resource);
+	std::pmr::vector<float> candidateY(pointCount, resource);
+	std::pmr::vector<float> rotatedX(pointCount, resource);
+	std::pmr::vector<float> rotatedY(pointCount, resource);
+	std::pmr::vector<int16_t> quantizedCandidate(2 * pointCount, resource);
+
+	for (int i = 0; i < pointCount; ++i)
+	{
+		candidateX[i] = candidate.GetPoint(i).x;
+		candidateY[i] = candidate.GetPoint(i).y;
+	}
+
+	const Vector2 centroid = candidate.GetCentroid();
+
+	float bestDistance = std::numeric_limits<float>::infinity();
+	matchingIndex = -1;
+
+	const int templateCount = GetTemplateCount();
+	for (int i = 0; i < templateCount; ++i)
+	{
+		PROFILE_STAGE(ProfileStage::AngleSearch);
+
+		const int16_t* templatePoints = points.data() + 2 * i * pointCount;
+
+		float distance = SearchBestAngle([&](float angle)
+		{
+			++workCounters.rotations;
+			workCounters.pointsTouched += 2 * pointCount;
+
+			RotatePoints(candidateX.data(), candidateY.data(), pointCount, angle, centroid.x, centroid.y, rotatedX.data(), rotatedY.data());
+			QuantizePoints(rotatedX.data(), rotatedY.data(), pointCount, quantizedCandidate.data());
+			return GetQuantizedPathDistance(quantizedCandidate.data(), templatePoints, pointCount);
+		}, ANGLE_ALPHA, ANGLE_BETA, ANGLE_DELTA);
+
+		if (distance < bestDistance)
+		{
+			bestDistance = distance;
+			matchingIndex = i;
+		}
+	}
+
+	score = 1.0f - bestDistance / (0.5f * std::sqrt((float)(size * size + size * size)));
+
+	WorkCounters::AddRecognition(workCounters - workCountersBefore);
+}
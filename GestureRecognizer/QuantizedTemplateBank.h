@@ -0,0 +1,45 @@
+// QuantizedTemplateBank.h
+// Programmer: Khoi Ho
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <vector>
+#include "Stroke.h"
+#include "TemplateBank.h"
+
+// A compact copy of a template bank which stores the coordinates as 16-bit fixed point numbers instead of floats.
+// The preprocessed templates are centered at the origin and fit in the square of the template size, so 16 bits keep a precision of 1/64 of a pixel.
+// Halving the size of the bank halves the memory traffic of the recognition when the bank does not fit in the cache.
+class QuantizedTemplateBank
+{
+public:
+	// Quantizes the templates of the bank.
+	void Build(const TemplateBank& bank);
+
+	int GetTemplateCount() const;
+	int GetPointCount() const;
+	int GetSize() const;
+
+	// Returns the name of a template.
+	const std::string& GetName(int index) const;
+
+	// Returns the number of bytes used by the coordinates.
+	size_t GetMemoryUsage() const;
+
+	// Finds the template that matches the preprocessed candidate and returns its index (or -1 if the bank is empty) and the score.
+	// The temporary buffers are allocated from the memory resource.
+	void Recognize(const Stroke& candidate, int& matchingIndex, float& score, std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const;
+
+private:
+	int pointCount = 0;
+	int size = 0;
+
+	std::vector<std::string> names;
+
+	// The points of template i are stored as x0, y0, x1, y1... from points[2 * i * pointCount].
+	std::vector<int16_t> points;
+};
@@ -0,0 +1,97 @@
+#include "RecognitionWorker.h"
+#include <memory>
+#include <memory_resource>
+#include "TemplateBank.h"
+
+RecognitionWorker::RecognitionWorker(const SharedTemplateBank& templateBank):templateBank(templateBank)
+{
+	// Start the thread last, once the queues exist.
+	thread = std::thread(&RecognitionWorker::Run, this);
+}
+
+RecognitionWorker::~RecognitionWorker()
+{
+	{
+		std::lock_guard<std::mutex> lock(wakeUpMutex);
+		isStopping = true;
+	}
+	wakeUp.notify_one();
+
+	thread.join();
+}
+
+bool RecognitionWorker::Submit(const Stroke& stroke)
+{
+	// The copy is allocated from the global heap, since the worker frees it.
+	Stroke strokeCopy(stroke, std::pmr::get_default_resource());
+	if (!strokes.TryPush(strokeCopy))
+		return false;
+
+	++pendingCount;
+
+	// Taking the mutex makes sure that the worker is either waiting or about to check the queue again, so the notification is not lost.
+	{
+		std::lock_guard<std::mutex> lock(wakeUpMutex);
+	}
+	wakeUp.notify_one();
+
+	return true;
+}
+
+bool RecognitionWorker::TryGetResult(RecognitionResult& result)
+{
+	if (!results.TryPop(result))
+		return false;
+
+	--pendingCount;
+	return true;
+}
+
+bool RecognitionWorker::IsBusy() const
+{
+	return pendingCount > 0;
+}
+
+void RecognitionWorker::Run()
+{
+	Stroke stroke;
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(wakeUpMutex);
+			wakeUp.wait(lock, [this]() { return isStopping || !strokes.IsEmpty(); });
+		}
+
+		if (isStopping)
+			return;
+
+		while (strokes.TryPop(stroke))
+		{
+			// The snapshot stays valid even if the templates are replaced during the recognition.
+			std::shared_ptr<const TemplateBank> templateSnapshot = templateBank.GetSnapshot();
+
+			RecognitionResult result;
+			if (templateSnapshot->GetTemplateCount() > 0)
+			{
+				// The temporary strokes of the recognition are allocated from an arena, which is released all at once when the recognition is done.
+				std::pmr::monotonic_buffer_resource recognitionArena;
+
+				Stroke normalizedStroke = stroke.Normalize(templateSnapshot->GetPointCount(), templateSnapshot->GetSize(), &recognitionArena);
+				templateSnapshot->Recognize(normalizedStroke, result.matchingIndex, result.score, &recognitionArena);
+
+				if (result.matchingIndex >= 0)
+					result.name = templateSnapshot->GetName(result.matchingIndex);
+			}
+
+			// The caller polls the results at every frame, so the queue is only full for a moment.
+			while (!results.TryPush(result))
+			{
+				if (isStopping)
+					return;
+
+				std::this_thread::yield();
+			}
+		}
+	}
+}
@@ -0,0 +1,68 @@
+// RecognitionWorker.h
+// Programmer: Khoi Ho
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "SharedTemplateBank.h"
+#include "SpscQueue.h"
+#include "Stroke.h"
+
+struct RecognitionResult
+{
+	// The index of the matching template in the snapshot used for the recognition, or -1 if there was no template.
+	int matchingIndex = -1;
+	float score = 0.0f;
+
+	// The name of the matching template, copied so that the result does not depend on the snapshot.
+	std::string name;
+};
+
+// Recognizes strokes on a background thread, so that the thread that submits them (e.g. the event and render loop) never waits for a recognition.
+// The strokes and the results go through lock-free single-producer single-consumer queues: one thread submits the strokes and polls the results,
+// and the worker recognizes them in order against the latest snapshot of the templates.
+class RecognitionWorker
+{
+public:
+	explicit RecognitionWorker(const SharedTemplateBank& templateBank);
+
+	// Stops the worker after the current recognition. The strokes that are still queued are dropped.
+	~RecognitionWorker();
+
+	RecognitionWorker(const RecognitionWorker&) = delete;
+	RecognitionWorker& operator=(const RecognitionWorker&) = delete;
+
+	// Queues a copy of the raw stroke for preprocessing and recognition. Returns false if too many strokes are already waiting.
+	bool Submit(const Stroke& stroke);
+
+	// Returns true and the oldest result that has not been returned yet, or false if none is ready. Never waits.
+	bool TryGetResult(RecognitionResult& result);
+
+	// Returns true if a submitted stroke has no result yet.
+	bool IsBusy() const;
+
+private:
+	// The number of strokes that can wait for the worker, and of results that can wait for the caller.
+	static const size_t QUEUE_CAPACITY = 4;
+
+	void Run();
+
+	const SharedTemplateBank& templateBank;
+
+	SpscQueue<Stroke, QUEUE_CAPACITY> strokes;
+	SpscQueue<RecognitionResult, QUEUE_CAPACITY> results;
+
+	// Only written by the submitting thread, and by TryGetResult on the same thread.
+	int pendingCount = 0;
+
+	// Only used to put the worker to sleep while there is no stroke. Submit takes the mutex for as long as it takes to notify the worker.
+	std::mutex wakeUpMutex;
+	std::condition_variable wakeUp;
+	std::atomic<bool> isStopping{ false };
+
+	std::thread thread;
+};
@@ -0,0 +1,21 @@
+#include "SharedTemplateBank.h"
+
+SharedTemplateBank::SharedTemplateBank(int pointCount, int size):currentVersion(std::make_shared<TemplateBank>(pointCount, size)) {}
+
+std::shared_ptr<const TemplateBank> SharedTemplateBank::GetSnapshot() const
+{
+	return std::atomic_load_explicit(&currentVersion, std::memory_order_acquire);
+}
+
+void SharedTemplateBank::Build(const std::vector<Stroke>& strokes)
+{
+	Update([&](TemplateBank& bank)
+	{
+		bank.Build(strokes);
+	});
+}
+
+void SharedTemplateBank::Publish(std::shared_ptr<const TemplateBank> newVersion)
+{
+	std::atomic_store_explicit(&currentVersion, std::move(newVersion), std::memory_order_release);
+}
@@ -0,0 +1,49 @@
+// SharedTemplateBank.h
+// Programmer: Khoi Ho
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "Stroke.h"
+#include "TemplateBank.h"
+
+// Publishes immutable versions of a template bank (read-copy-update), so that the recognition can run on any thread while the templates change.
+// A reader takes a snapshot of the current version and keeps it alive for as long as it uses it. A writer copies the current version, changes the copy
+// and publishes it by swapping the pointer, so readers never wait for a build and the previous version is freed when its last reader releases it.
+// This is not lock-free: the atomic operations on a shared_ptr take a short internal lock around the copy or the swap of the pointer,
+// but that lock is never held during a build, so a reader only waits for another pointer copy or swap, never for a writer.
+class SharedTemplateBank
+{
+public:
+	// The first version is an empty bank with the specified number of points and size.
+	SharedTemplateBank(int pointCount = 64, int size = 250);
+
+	// Returns the current version. It only waits for a concurrent copy or swap of the pointer.
+	std::shared_ptr<const TemplateBank> GetSnapshot() const;
+
+	// Copies the current version, calls update on the copy and publishes it. Writers are serialized by a mutex, which readers never take.
+	template <typename Function>
+	void Update(Function update)
+	{
+		std::lock_guard<std::mutex> lock(writerMutex);
+
+		std::shared_ptr<TemplateBank> newVersion = std::make_shared<TemplateBank>(*GetSnapshot());
+		update(*newVersion);
+
+		Publish(std::move(newVersion));
+	}
+
+	// Publishes a new version built from the strokes, keeping the settings of the current version.
+	void Build(const std::vector<Stroke>& strokes);
+
+private:
+	void Publish(std::shared_ptr<const TemplateBank> newVersion);
+
+	// Only read and written with std::atomic_load and std::atomic_store, which lock an internal mutex of the standard library (std::atomic_is_lock_free is false).
+	// These overloads are deprecated in C++20 in favor of std::atomic<std::shared_ptr>.
+	std::shared_ptr<const TemplateBank> currentVersion;
+
+	std::mutex writerMutex;
+};
@@ -0,0 +1,53 @@
+// SpscQueue.h
+// Programmer: Khoi Ho
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// A bounded queue between exactly one producer thread and one consumer thread, which never locks or allocates.
+// The producer only writes the tail and the consumer only writes the head, so each index has a single writer.
+// The release store of an index publishes the slot it covers, and the acquire load on the other side sees it.
+template <typename T, size_t Capacity>
+class SpscQueue
+{
+public:
+	// Moves the item into the queue and returns true, or returns false and leaves the item unchanged if the queue is full. Only called by the producer.
+	bool TryPush(T& item)
+	{
+		const size_t tail = this->tail.load(std::memory_order_relaxed);
+		if (tail - head.load(std::memory_order_acquire) == Capacity)
+			return false;
+
+		slots[tail % Capacity] = std::move(item);
+		this->tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Moves the oldest item out of the queue and returns true, or returns false if the queue is empty. Only called by the consumer.
+	bool TryPop(T& item)
+	{
+		const size_t head = this->head.load(std::memory_order_relaxed);
+		if (head == tail.load(std::memory_order_acquire))
+			return false;
+
+		item = std::move(slots[head % Capacity]);
+		this->head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Returns true if the queue looks empty. The answer may be outdated by the time it is used, unless the caller is the only thread that can fill the queue.
+	bool IsEmpty() const
+	{
+		return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+	}
+
+private:
+	T slots[Capacity];
+
+	// The indices only grow. They are on separate cache lines, so that the producer and the consumer do not invalidate each other's line at every operation.
+	alignas(64) std::atomic<size_t> head{ 0 };
+	alignas(64) std::atomic<size_t> tail{ 0 };
+};
@@ -1,17 +1,58 @@
 #include "Stroke.h"
+#include <algorithm>
 #include <limits>
 #include <cmath>
+#include <utility>
+#include "PerfCounters.h"
+#include "Profiler.h"
+#include "Tracer.h"
+#include "WorkCounters.h"
 
-Stroke::Stroke():name(std::string()) {}
+Stroke::Stroke(std::pmr::memory_resource* resource):name(resource), points(resource), cachedArcLengths(resource) {}
 
-Stroke::Stroke(const std::string& name):name(name) {}
+Stroke::Stroke(std::string_view name, std::pmr::memory_resource* resource):name(name, resource), points(resource), cachedArcLengths(resource) {}
 
-Stroke::Stroke(const Stroke& other):name(other.name), points(other.points) {}
+Stroke::Stroke(const Stroke& other):name(other.name), points(other.points)
+{
+	CopyInvariants(other);
+}
+
+Stroke::Stroke(const Stroke& other, std::pmr::memory_resource* resource):name(other.name, resource), points(other.points, resource), cachedArcLengths(resource)
+{
+	CopyInvariants(other);
+}
+
+Stroke::Stroke(Stroke&& other) noexcept:name(std::move(other.name)), points(std::move(other.points)), cachedArcLengths(std::move(other.cachedArcLengths))
+{
+	CopyInvariants(other);
+	hasArcLengths = other.hasArcLengths;
+	other.InvalidateInvariants();
+}
 
 Stroke& Stroke::operator=(const Stroke& other)
 {
 	this->name = other.name;
 	this->points = other.points;
+	CopyInvariants(other);
+
+	return *this;
+}
+
+Stroke& Stroke::operator=(Stroke&& other)
+{
+	// The memory is only taken over if both strokes use the same memory resource. Otherwise, the values are copied.
+	this->name = std::move(other.name);
+	this->points = std::move(other.points);
+	CopyInvariants(other);
+
+	// The cumulative lengths are only taken over with the memory, like the points. Otherwise, they are rebuilt when needed.
+	if (GetMemoryResource() == other.GetMemoryResource())
+	{
+		this->cachedArcLengths = std::move(other.cachedArcLengths);
+		hasArcLengths = other.hasArcLengths;
+	}
+
+	other.InvalidateInvariants();
 
 	return *this;
 }
@@ -26,6 +67,99 @@ bool Stroke::operator<(const Stroke& other)
 	return this->name < other.name;
 }
 
+std::pmr::memory_resource* Stroke::GetMemoryResource() const
+{
+	return points.get_allocator().resource();
+}
+
+const std::pmr::vector<Vector2>& Stroke::GetPoints() const
+{
+	return points;
+}
+
+int Stroke::GetPointCount() const
+{
+	return points.size();
+}
+
+const Vector2& Stroke::GetPoint(int index) const
+{
+	return points[index];
+}
+
+void Stroke::AddPoint(const Vector2& point)
+{
+	points.push_back(point);
+	InvalidateInvariants();
+}
+
+void Stroke::SetPoint(int index, const Vector2& point)
+{
+	points[index] = point;
+	InvalidateInvariants();
+}
+
+void Stroke::ReservePoints(int pointCount)
+{
+	points.reserve(pointCount);
+}
+
+void Stroke::ClearPoints()
+{
+	points.clear();
+	InvalidateInvariants();
+}
+
+void Stroke::CopyInvariants(const Stroke& other)
+{
+	cachedCentroid = other.cachedCentroid;
+	cachedTopLeftCorner = other.cachedTopLeftCorner;
+	cachedBottomRightCorner = other.cachedBottomRightCorner;
+	cachedPathLength = other.cachedPathLength;
+	cachedIndicativeAngle = other.cachedIndicativeAngle;
+
+	hasCentroid = other.hasCentroid;
+	hasBoundingBox = other.hasBoundingBox;
+	hasPathLength = other.hasPathLength;
+	hasIndicativeAngle = other.hasIndicativeAngle;
+
+	// Copying the cumulative lengths would allocate, so they are rebuilt when needed.
+	hasArcLengths = false;
+}
+
+void Stroke::InvalidateInvariants()
+{
+	hasCentroid = false;
+	hasBoundingBox = false;
+	hasPathLength = false;
+	hasIndicativeAngle = false;
+	hasArcLengths = false;
+}
+
+void Stroke::BuildArcLengths() const
+{
+	if (hasArcLengths)
+		return;
+
+	const int pointCount = points.size();
+
+	WorkCounters::GetThreadCounters().pointsTouched += pointCount;
+
+	// Summed in the same order as GetPathLength, so the last length is the path length.
+	cachedArcLengths.resize(pointCount);
+
+	float length = 0;
+	for (int i = 0; i < pointCount; ++i)
+	{
+		if (i > 0)
+			length += Vector2::Distance(points[i - 1], points[i]);
+
+		cachedArcLengths[i] = length;
+	}
+
+	hasArcLengths = true;
+}
+
 Vector2 Stroke::GetCentroid() const
 {
 	const int pointCount = points.size();
@@ -33,6 +167,9 @@ Vector2 Stroke::GetCentroid() const
 	if (pointCount == 0)
 		throw std::exception("Cannot find the centroid: The stroke has no point.");
 
+	if (hasCentroid)
+		return cachedCentroid;
+
 	float sumX = 0;
 	float sumY = 0;
 	for (int i = 0; i < pointCount; ++i)
@@ -41,7 +178,10 @@ Vector2 Stroke::GetCentroid() const
 		sumY += points[i].y;
 	}
 
-	return Vector2(sumX / pointCount, sumY / pointCount);
+	cachedCentroid = Vector2(sumX / pointCount, sumY / pointCount);
+	hasCentroid = true;
+
+	return cachedCentroid;
 }
 
 void Stroke::GetBoundingBox(Vector2& topLeftCorner, Vector2& bottomRightCorner) const
@@ -51,29 +191,37 @@ void Stroke::GetBoundingBox(Vector2& topLeftCorner, Vector2& bottomRightCorner)
 	if (pointCount == 0)
 		throw std::exception("Cannot find the bounding box: The stroke has no point.");
 
-	float minX = points[0].x;
-	float minY = points[0].y;
-	float maxX = points[0].x;
-	float maxY = points[0].y;
-
-	for (int i = 1; i < pointCount; ++i)
+	if (!hasBoundingBox)
 	{
-		if (points[i].x < minX)
-			minX = points[i].x;
-		else if (points[i].x > maxX)
-			maxX = points[i].x;
-
-		if (points[i].y < minY)
-			minY = points[i].y;
-		else if (points[i].y > maxY)
-			maxY = points[i].y;
-	}
+		float minX = points[0].x;
+		float minY = points[0].y;
+		float maxX = points[0].x;
+		float maxY = points[0].y;
+
+		for (int i = 1; i < pointCount; ++i)
+		{
+			if (points[i].x < minX)
+				minX = points[i].x;
+			else if (points[i].x > maxX)
+				maxX = points[i].x;
+
+			if (points[i].y < minY)
+				minY = points[i].y;
+			else if (points[i].y > maxY)
+				maxY = points[i].y;
+		}
+
+		cachedTopLeftCorner.x = minX;
+		cachedTopLeftCorner.y = minY;
+
+		cachedBottomRightCorner.x = maxX;
+		cachedBottomRightCorner.y = maxY;
 
-	topLeftCorner.x = minX;
-	topLeftCorner.y = minY;
+		hasBoundingBox = true;
+	}
 
-	bottomRightCorner.x = maxX;
-	bottomRightCorner.y = maxY;
+	topLeftCorner = cachedTopLeftCorner;
+	bottomRightCorner = cachedBottomRightCorner;
 }
 
 float Stroke::GetPathLength() const
@@ -83,21 +231,65 @@ float Stroke::GetPathLength() const
 	if (pointCount <= 1)
 		return 0.0f;
 
-	float length = 0;
-	for (int i = 1; i < pointCount; ++i)
-		length += Vector2::Distance(points[i - 1], points[i]);
-	return length;
+	if (!hasPathLength)
+	{
+		float length = 0;
+		for (int i = 1; i < pointCount; ++i)
+			length += Vector2::Distance(points[i - 1], points[i]);
+
+		cachedPathLength = length;
+		hasPathLength = true;
+	}
+
+	return cachedPathLength;
 }
 
-Stroke Stroke::Resample(int numPoints) const
+float Stroke::GetArcLength(int index) const
+{
+	BuildArcLengths();
+	return cachedArcLengths[index];
+}
+
+Vector2 Stroke::GetPointAtArcLength(float length) const
 {
+	if (points.size() == 0)
+		throw std::exception("Cannot find the point at the arc length: The stroke has no point.");
+
+	BuildArcLengths();
+
+	// The first point beyond the length.
+	const int next = std::upper_bound(cachedArcLengths.begin(), cachedArcLengths.end(), length) - cachedArcLengths.begin();
+
+	if (next == 0)
+		return points.front();
+	if (next == (int)points.size())
+		return points.back();
+
+	// The segment is not empty, since the length of the previous point is at most the length and the length of the next point is greater.
+	const float t = (length - cachedArcLengths[next - 1]) / (cachedArcLengths[next] - cachedArcLengths[next - 1]);
+
+	Vector2 point;
+	point.x = points[next - 1].x + t * (points[next].x - points[next - 1].x);
+	point.y = points[next - 1].y + t * (points[next].y - points[next - 1].y);
+	return point;
+}
+
+Stroke Stroke::Resample(int numPoints, std::pmr::memory_resource* resource) const
+{
+	PROFILE_STAGE(ProfileStage::Resample);
+
 	if (points.size() == 0)
 		throw std::exception("Cannot resample the stroke: The stroke has no point.");
 
+	WorkCounters::GetThreadCounters().pointsTouched += points.size();
+
+	if (resource == nullptr)
+		resource = GetMemoryResource();
+
 	// Create a copy stroke. We don't want to change the original points.
-	Stroke strokeCopy(*this);
+	Stroke strokeCopy(*this, resource);
 
-	Stroke resampledStroke(name);
+	Stroke resampledStroke(name, resource);
 	resampledStroke.points.reserve(numPoints);
 
 	float I = strokeCopy.GetPathLength() / (numPoints - 1);
@@ -119,6 +311,7 @@ Stroke Stroke::Resample(int numPoints) const
 			resampledStroke.points.push_back(newPoint);
 
 			strokeCopy.points.insert(strokeCopy.points.begin() + i, newPoint);
+			strokeCopy.InvalidateInvariants();
 
 			D = 0;
 		}
@@ -133,22 +326,100 @@ Stroke Stroke::Resample(int numPoints) const
 	return resampledStroke;
 }
 
+Stroke Stroke::ResampleSubpath(int numPoints, float startLength, float endLength, std::pmr::memory_resource* resource) const
+{
+	PROFILE_STAGE(ProfileStage::Resample);
+
+	if (points.size() == 0)
+		throw std::exception("Cannot resample the stroke: The stroke has no point.");
+
+	WorkCounters::GetThreadCounters().pointsTouched += numPoints;
+
+	Stroke resampledStroke(name, resource != nullptr ? resource : GetMemoryResource());
+	resampledStroke.points.reserve(numPoints);
+
+	// The points do not depend on each other, so they could be found in any order.
+	const float step = numPoints > 1 ? (endLength - startLength) / (numPoints - 1) : 0.0f;
+	for (int i = 0; i < numPoints; ++i)
+	{
+		const float length = i == numPoints - 1 && numPoints > 1 ? endLength : startLength + i * step;
+		resampledStroke.points.push_back(GetPointAtArcLength(length));
+	}
+
+	return resampledStroke;
+}
+
+Stroke Stroke::ResampleByArcLength(int numPoints, std::pmr::memory_resource* resource) const
+{
+	return ResampleSubpath(numPoints, 0.0f, GetPathLength(), resource);
+}
+
 float Stroke::GetIndicativeAngle() const
 {
 	if (points.size() < 2)
 		throw std::exception("Cannot find the indicative angle: The stroke must have at least 2 points.");
 
+	if (!hasIndicativeAngle)
+	{
+		Vector2 centroid = GetCentroid();
+		cachedIndicativeAngle = atan2(centroid.y - points[0].y, centroid.x - points[0].x);
+		hasIndicativeAngle = true;
+	}
+
+	return cachedIndicativeAngle;
+}
+
+Stroke Stroke::RotateBy(float angle, std::pmr::memory_resource* resource) const&
+{
+	Stroke newStroke(resource != nullptr ? resource : GetMemoryResource());
+	RotateBy(angle, newStroke);
+	return newStroke;
+}
+
+Stroke Stroke::RotateBy(float angle, std::pmr::memory_resource* resource) &&
+{
+	// The points can only be reused if the new stroke stays in the memory resource of this stroke.
+	if (resource != nullptr && resource != GetMemoryResource())
+		return std::as_const(*this).RotateBy(angle, resource);
+
+	PROFILE_STAGE(ProfileStage::RotateBy);
+
+	if (points.size() == 0)
+		throw std::exception("Cannot rotate the stroke: The stroke has no point.");
+
+	WorkCounters& workCounters = WorkCounters::GetThreadCounters();
+	++workCounters.rotations;
+	workCounters.pointsTouched += points.size();
+
 	Vector2 centroid = GetCentroid();
-	return atan2(centroid.y - points[0].y, centroid.x - points[0].x);
+
+	for (Vector2& point : points)
+	{
+		Vector2 newPoint;
+		newPoint.x = (point.x - centroid.x) * std::cos(angle) - (point.y - centroid.y) * std::sin(angle) + centroid.x;
+		newPoint.y = (point.x - centroid.x) * std::sin(angle) + (point.y - centroid.y) * std::cos(angle) + centroid.y;
+
+		point = newPoint;
+	}
+
+	InvalidateInvariants();
+	return std::move(*this);
 }
 
-Stroke Stroke::RotateBy(float angle) const
+void Stroke::RotateBy(float angle, Stroke& rotatedStroke) const
 {
+	PROFILE_STAGE(ProfileStage::RotateBy);
+
 	if (points.size() == 0)
 		throw std::exception("Cannot rotate the stroke: The stroke has no point.");
 
-	Stroke newStroke(name);
-	newStroke.points.reserve(this->points.size());
+	WorkCounters& workCounters = WorkCounters::GetThreadCounters();
+	++workCounters.rotations;
+	workCounters.pointsTouched += points.size();
+
+	rotatedStroke.name = name;
+	rotatedStroke.ClearPoints();
+	rotatedStroke.points.reserve(this->points.size());
 
 	Vector2 centroid = GetCentroid();
 
@@ -158,19 +429,27 @@ Stroke Stroke::RotateBy(float angle) const
 		newPoint.x = (point.x - centroid.x) * std::cos(angle) - (point.y - centroid.y) * std::sin(angle) + centroid.x;
 		newPoint.y = (point.x - centroid.x) * std::sin(angle) + (point.y - centroid.y) * std::cos(angle) + centroid.y;
 
-		newStroke.points.push_back(newPoint);
+		rotatedStroke.points.push_back(newPoint);
 	}
+}
 
-	return newStroke;
+Stroke Stroke::ScaleTo(const int& size, std::pmr::memory_resource* resource) const&
+{
+	Stroke newStroke(*this, resource != nullptr ? resource : GetMemoryResource());
+	return std::move(newStroke).ScaleTo(size);
 }
 
-Stroke Stroke::ScaleTo(const int& size) const
+Stroke Stroke::ScaleTo(const int& size, std::pmr::memory_resource* resource) &&
 {
+	if (resource != nullptr && resource != GetMemoryResource())
+		return std::as_const(*this).ScaleTo(size, resource);
+
+	PROFILE_STAGE(ProfileStage::ScaleTo);
+
 	if (points.size() == 0)
 		throw std::exception("Cannot scale the stroke: The stroke has no point.");
 
-	Stroke newStroke(name);
-	newStroke.points.reserve(this->points.size());
+	WorkCounters::GetThreadCounters().pointsTouched += points.size();
 
 	// Get the bounding box of the points.
 	Vector2 topLeftCorner;
@@ -181,41 +460,91 @@ Stroke Stroke::ScaleTo(const int& size) const
 	float width = bottomRightCorner.x - topLeftCorner.x;
 	float height = bottomRightCorner.y - topLeftCorner.y;
 
-	for (const Vector2& point : points)
+	for (Vector2& point : points)
 	{
-		Vector2 newPoint;
-		newPoint.x = point.x * size / width;
-		newPoint.y = point.y * size / height;
-
-		newStroke.points.push_back(newPoint);
+		point.x = point.x * size / width;
+		point.y = point.y * size / height;
 	}
 
-	return newStroke;
+	InvalidateInvariants();
+	return std::move(*this);
+}
+
+Stroke Stroke::TranslateTo(const Vector2& target, std::pmr::memory_resource* resource) const&
+{
+	Stroke newStroke(*this, resource != nullptr ? resource : GetMemoryResource());
+	return std::move(newStroke).TranslateTo(target);
 }
 
-Stroke Stroke::TranslateTo(const Vector2& target) const
+Stroke Stroke::TranslateTo(const Vector2& target, std::pmr::memory_resource* resource) &&
 {
+	if (resource != nullptr && resource != GetMemoryResource())
+		return std::as_const(*this).TranslateTo(target, resource);
+
+	PROFILE_STAGE(ProfileStage::TranslateTo);
+
 	const int pointCount = points.size();
 
 	if (pointCount == 0)
 		throw std::exception("Cannot translate the stroke: The stroke has no point.");
 
-	Stroke newStroke(name);
-	newStroke.points.reserve(pointCount);
+	WorkCounters::GetThreadCounters().pointsTouched += pointCount;
 
 	Vector2 centroid = GetCentroid();
 	Vector2 displacementToTarget = target - centroid;
 
-	for (const Vector2& point : points)
+	for (Vector2& point : points)
 	{
-		Vector2 newPoint;
-		newPoint.x = point.x + displacementToTarget.x;
-		newPoint.y = point.y + displacementToTarget.y;
-
-		newStroke.points.push_back(newPoint);
+		point.x = point.x + displacementToTarget.x;
+		point.y = point.y + displacementToTarget.y;
 	}
 
-	return newStroke;
+	InvalidateInvariants();
+	return std::move(*this);
+}
+
+Stroke Stroke::Normalize(int numPoints, int size, std::pmr::memory_resource* resource) const
+{
+	// Each step transforms the resampled stroke in place.
+	Stroke resampledStroke = Resample(numPoints, resource);
+	const float indicativeAngle = resampledStroke.GetIndicativeAngle();
+	return std::move(resampledStroke).RotateBy(-indicativeAngle).ScaleTo(size).TranslateTo();
+}
+
+StrokeFeatures Stroke::GetFeatures(int numPoints, std::pmr::memory_resource* resource) const
+{
+	Stroke rotatedStroke = Resample(numPoints, resource);
+	rotatedStroke = std::move(rotatedStroke).RotateBy(-rotatedStroke.GetIndicativeAngle());
+
+	return rotatedStroke.GetFeaturesOfRotatedStroke();
+}
+
+StrokeFeatures Stroke::GetFeaturesOfRotatedStroke() const
+{
+	// Avoids dividing by 0 for straight lines and dots.
+	const float EPSILON = 1.0f;
+
+	Vector2 topLeftCorner;
+	Vector2 bottomRightCorner;
+	GetBoundingBox(topLeftCorner, bottomRightCorner);
+
+	const float width = bottomRightCorner.x - topLeftCorner.x;
+	const float height = bottomRightCorner.y - topLeftCorner.y;
+	const float diagonal = std::sqrt(width * width + height * height);
+	const float pathLength = GetPathLength();
+
+	const Vector2& firstPoint = points.front();
+	const Vector2& lastPoint = points.back();
+	const float endDistance = Vector2::Distance(firstPoint, lastPoint);
+
+	StrokeFeatures features;
+	features.values[(int)StrokeFeature::AspectRatio] = std::log((width + EPSILON) / (height + EPSILON));
+	features.values[(int)StrokeFeature::PathLengthRatio] = pathLength / std::fmax(diagonal, EPSILON);
+	features.values[(int)StrokeFeature::DirectionX] = endDistance > EPSILON ? (lastPoint.x - firstPoint.x) / endDistance : 0.0f;
+	features.values[(int)StrokeFeature::DirectionY] = endDistance > EPSILON ? (lastPoint.y - firstPoint.y) / endDistance : 0.0f;
+	features.values[(int)StrokeFeature::Closedness] = endDistance / std::fmax(pathLength, EPSILON);
+
+	return features;
 }
 
 float Stroke::GetPathDistance(const Stroke& other) const
@@ -228,6 +557,8 @@ float Stroke::GetPathDistance(const Stroke& other) const
 	else if (thisStrokeSize == 0)
 		throw std::exception("Error: Cannot find the path distance: Both strokes do not have any points.");
 
+	WorkCounters::GetThreadCounters().pointsTouched += thisStrokeSize;
+
 	float distance = 0;
 	for (int i = 0; i < thisStrokeSize; ++i)
 		distance += Vector2::Distance(points[i], other.points[i]);
@@ -236,30 +567,48 @@ float Stroke::GetPathDistance(const Stroke& other) const
 
 float Stroke::GetDistanceAtAngle(const Stroke& other, const float& angle) const
 {
-	Stroke rotatedStroke = RotateBy(angle);
+	Stroke rotatedStroke(GetMemoryResource());
+	return GetDistanceAtAngle(other, angle, rotatedStroke);
+}
+
+float Stroke::GetDistanceAtAngle(const Stroke& other, const float& angle, Stroke& rotatedStroke) const
+{
+	++WorkCounters::GetThreadCounters().distanceEvaluations;
+
+	RotateBy(angle, rotatedStroke);
 	float distance = rotatedStroke.GetPathDistance(other);
 	return distance;
 }
 
 float Stroke::GetDistanceAtBestAngle(const Stroke& other, float angleAlpha, float angleBeta, const float& angleDelta) const
 {
+	Stroke rotatedStroke(GetMemoryResource());
+	return GetDistanceAtBestAngle(other, angleAlpha, angleBeta, angleDelta, rotatedStroke);
+}
+
+float Stroke::GetDistanceAtBestAngle(const Stroke& other, float angleAlpha, float angleBeta, const float& angleDelta, Stroke& rotatedStroke) const
+{
+	PROFILE_STAGE(ProfileStage::AngleSearch);
+
 	static const float phi = 0.5f * (-1.0f + std::sqrt(5.0f));
 
 	float x1 = phi * angleAlpha + (1.0f - phi) * angleBeta;
-	float f1 = GetDistanceAtAngle(other, x1);
+	float f1 = GetDistanceAtAngle(other, x1, rotatedStroke);
 
 	float x2 = (1.0f - phi) * angleAlpha + phi * angleBeta;
-	float f2 = GetDistanceAtAngle(other, x2);
+	float f2 = GetDistanceAtAngle(other, x2, rotatedStroke);
 
 	while (std::abs(angleBeta - angleAlpha) > angleDelta)
 	{
+		++WorkCounters::GetThreadCounters().angleSearchIterations;
+
 		if (f1 < f2)
 		{
 			angleBeta = x2;
 			x2 = x1;
 			f2 = f1;
 			x1 = phi * angleAlpha + (1.0f - phi) * angleBeta;
-			f1 = GetDistanceAtAngle(other, x1);
+			f1 = GetDistanceAtAngle(other, x1, rotatedStroke);
 		}
 		else
 		{
@@ -267,32 +616,50 @@ float Stroke::GetDistanceAtBestAngle(const Stroke& other, float angleAlpha, floa
 			x1 = x2;
 			f1 = f2;
 			x2 = (1.0f - phi) * angleAlpha + phi * angleBeta;
-			f2 = GetDistanceAtAngle(other, x2);
+			f2 = GetDistanceAtAngle(other, x2, rotatedStroke);
 		}
 	}
 
 	return f1 < f2 ? f1 : f2;
 }
 
-void Stroke::Recognize(std::vector<Stroke>& strokeTemplates, const float& size, Stroke& matchingStroke, float& score) const
+void Stroke::Recognize(const std::vector<Stroke>& strokeTemplates, const float& size, Stroke& matchingStroke, float& score, std::pmr::memory_resource* resource) const
 {
+	PROFILE_STAGE(ProfileStage::Recognize);
+	TRACE_SCOPE("Recognize", "recognition");
+	PERF_SCOPE(PerfStage::Recognize);
+
 	static const float PI = 2.0f * std::acosf(0.0f);
 	static const float ANGLE_ALPHA = -0.25f * PI; //  45 degrees.
 	static const float ANGLE_BETA = 0.25f * PI;   // -45 degrees.
 	static const float ANGLE_DELTA = PI / 90.0f;  //   2 degrees.
 
+	// Remember the work done so far, so that the work of this recognition can be measured.
+	const WorkCounters workCountersBefore = WorkCounters::GetThreadCounters();
+
+	// The rotated stroke is allocated once and reused for every template.
+	Stroke rotatedStroke(resource != nullptr ? resource : GetMemoryResource());
+	rotatedStroke.points.reserve(points.size());
+
 	float bestDistance = std::numeric_limits<float>::infinity();
+	const Stroke* bestTemplate = nullptr;
 
-	for (Stroke& strokeTemplate : strokeTemplates)
+	for (const Stroke& strokeTemplate : strokeTemplates)
 	{
-		float distance = GetDistanceAtBestAngle(strokeTemplate, ANGLE_ALPHA, ANGLE_BETA, ANGLE_DELTA);
+		float distance = GetDistanceAtBestAngle(strokeTemplate, ANGLE_ALPHA, ANGLE_BETA, ANGLE_DELTA, rotatedStroke);
 
 		if (distance < bestDistance)
 		{
 			bestDistance = distance;
-			matchingStroke = strokeTemplate;
+			bestTemplate = &strokeTemplate;
 		}		
 	}
 
+	// Only copy the matching stroke once.
+	if (bestTemplate != nullptr)
+		matchingStroke = *bestTemplate;
+
 	score = 1.0f - bestDistance / (0.5f * std::sqrt(size * size + size * size));
+
+	WorkCounters::AddRecognition(WorkCounters::GetThreadCounters() - workCountersBefore);
 }
\ No newline at end of file
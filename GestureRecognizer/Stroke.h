@@ -3,26 +3,57 @@
 
 #pragma once
 
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <vector>
 #include "Vector2.h"
 
+// Cheap features of a stroke, which do not depend on its position, size and rotation.
+enum class StrokeFeature
+{
+	// The logarithm of the width over the height of the bounding box, after the rotation by the indicative angle.
+	AspectRatio,
+
+	// The path length over the diagonal of the bounding box.
+	PathLengthRatio,
+
+	// The direction from the first point to the last point, after the rotation by the indicative angle.
+	DirectionX,
+	DirectionY,
+
+	// The distance between the first point and the last point over the path length. It is 0 for a closed stroke.
+	Closedness,
+
+	Count
+};
+
+struct StrokeFeatures
+{
+	float values[(int)StrokeFeature::Count];
+};
+
 // Reference: http://faculty.washington.edu/wobbrock/pubs/uist-07.01.pdf
 class Stroke
 {
 public:
     // The name of the stroke.
-    std::string name;
+    std::pmr::string name;
 
-    // The points of the stroke.
-    std::vector<Vector2> points;
+	// The name and the points are allocated from the memory resource. By default, it is the global heap.
+	explicit Stroke(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+	Stroke(std::string_view name, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
-	Stroke();
-	Stroke(const std::string& name);
+	// The copy is allocated from the global heap, or from the memory resource if specified.
 	Stroke(const Stroke& other);
+	Stroke(const Stroke& other, std::pmr::memory_resource* resource);
+
+	// The new stroke takes over the memory (and the memory resource) of the other stroke, so that returning and sorting strokes does not copy the points.
+	Stroke(Stroke&& other) noexcept;
 
 	// Used for copying values instead of copying the reference.
 	Stroke& operator= (const Stroke& other);
+	Stroke& operator= (Stroke&& other);
 
 	// Used for checking if the two strokes share the same values instead of the same reference.
 	bool operator== (const Stroke& other);
@@ -30,6 +61,23 @@ public:
 	// Used for sorting strokes by name.
 	bool operator< (const Stroke& other);
 
+	// Returns the memory resource of the stroke.
+	std::pmr::memory_resource* GetMemoryResource() const;
+
+	// Returns the points of the stroke. They can only be changed with the functions below, so that the cached invariants stay valid.
+	const std::pmr::vector<Vector2>& GetPoints() const;
+	int GetPointCount() const;
+	const Vector2& GetPoint(int index) const;
+
+	// Change the points and discard the cached invariants.
+	void AddPoint(const Vector2& point);
+	void SetPoint(int index, const Vector2& point);
+	void ReservePoints(int pointCount);
+	void ClearPoints();
+
+	// The centroid, the bounding box, the path length and the indicative angle are computed on the first call and cached until the points change.
+	// Computing them writes to the cache, so a stroke that is shared between threads must have them computed beforehand.
+
 	// Returns the centroid of the stroke.
 	Vector2 GetCentroid() const;
 
@@ -39,31 +87,97 @@ public:
 	// Returns the total length of the stroke.
 	float GetPathLength() const;
 
+	// Returns the length of the path from the first point to the point with the specified index.
+	// The cumulative lengths of all the points are computed on the first call and cached with the other invariants.
+	float GetArcLength(int index) const;
+
+	// Returns the point at the specified length along the path, interpolated between the 2 points around it, which are found by a binary search in the cumulative lengths.
+	// The length is clamped to the path.
+	Vector2 GetPointAtArcLength(float length) const;
+
+	// The transforms below allocate the new stroke from the memory resource, or from the memory resource of this stroke if it is null.
+	// When called on an expiring stroke (e.g. stroke = std::move(stroke).ScaleTo()), RotateBy, ScaleTo and TranslateTo transform it in place instead,
+	// unless a different memory resource is specified.
+
 	// Resamples the points into the specified number of evenly spaced points.
-	Stroke Resample(int numPoints = 64) const;
+	Stroke Resample(int numPoints = 64, std::pmr::memory_resource* resource = nullptr) const;
+
+	// Resamples the path between the arc lengths startLength and endLength into numPoints evenly spaced points. Each point is found on its own with GetPointAtArcLength,
+	// so unlike Resample, any sub-path can be resampled and resampling the same stroke at several resolutions only measures the path once. The results match Resample up to rounding.
+	Stroke ResampleSubpath(int numPoints, float startLength, float endLength, std::pmr::memory_resource* resource = nullptr) const;
+
+	// Resamples the whole path as above.
+	Stroke ResampleByArcLength(int numPoints = 64, std::pmr::memory_resource* resource = nullptr) const;
 
 	// Finds the indicative angle from the first point of the stroke to the centroid.
 	float GetIndicativeAngle() const;
 
 	// Rotates the stroke by an angle around the centroid.
-	Stroke RotateBy(float angle) const;
+	Stroke RotateBy(float angle, std::pmr::memory_resource* resource = nullptr) const&;
+	Stroke RotateBy(float angle, std::pmr::memory_resource* resource = nullptr) &&;
+
+	// Rotates the stroke by an angle around the centroid and stores the result in rotatedStroke, reusing its memory.
+	void RotateBy(float angle, Stroke& rotatedStroke) const;
 
 	// Scales the stroke to match the bounding box. The size parameter is the size of each side of the bounding box.
-	Stroke ScaleTo(const int& size = 250) const;
+	Stroke ScaleTo(const int& size = 250, std::pmr::memory_resource* resource = nullptr) const&;
+	Stroke ScaleTo(const int& size = 250, std::pmr::memory_resource* resource = nullptr) &&;
 
 	// Translates the stroke to the origin.
-	Stroke TranslateTo(const Vector2& origin = Vector2()) const;
+	Stroke TranslateTo(const Vector2& origin = Vector2(), std::pmr::memory_resource* resource = nullptr) const&;
+	Stroke TranslateTo(const Vector2& origin = Vector2(), std::pmr::memory_resource* resource = nullptr) &&;
+
+	// Resamples the stroke, rotates it by its indicative angle, scales it and translates it to the origin, as in steps 1 to 3 of the $1 recognizer.
+	Stroke Normalize(int numPoints = 64, int size = 250, std::pmr::memory_resource* resource = nullptr) const;
+
+	// Resamples the stroke, rotates it by its indicative angle and returns its features. The temporary strokes are allocated as in the transforms.
+	StrokeFeatures GetFeatures(int numPoints = 64, std::pmr::memory_resource* resource = nullptr) const;
+
+	// Returns the features of the stroke, which is already resampled and rotated by its indicative angle, as in GetFeatures.
+	StrokeFeatures GetFeaturesOfRotatedStroke() const;
 
 	// Returns the average distance between respective points of the 2 strokes.
 	float GetPathDistance(const Stroke& other) const;
 
 	// Returns the distance between this stroke, rotated by an angle, and the other stroke.
+	// The rotated stroke is stored in rotatedStroke if specified, so that its memory can be reused across calls.
 	float GetDistanceAtAngle(const Stroke& other, const float& angle) const;
+	float GetDistanceAtAngle(const Stroke& other, const float& angle, Stroke& rotatedStroke) const;
 
-	// ??? 
+	// Finds the angle between angleAlpha and angleBeta at which this stroke is the closest to the other stroke using the golden-section search, and returns the distance.
 	float GetDistanceAtBestAngle(const Stroke& other, float angleAlpha, float angleBeta, const float& angleDelta) const;
+	float GetDistanceAtBestAngle(const Stroke& other, float angleAlpha, float angleBeta, const float& angleDelta, Stroke& rotatedStroke) const;
 
 	// Finds the stroke that matches this stroke and returns the score.
-	void Recognize(std::vector<Stroke>& strokeTemplates, const float& size, Stroke& matchingStroke, float& score) const;
-};
+	// The temporary strokes are allocated from the memory resource, or from the memory resource of this stroke if it is null.
+	void Recognize(const std::vector<Stroke>& strokeTemplates, const float& size, Stroke& matchingStroke, float& score, std::pmr::memory_resource* resource = nullptr) const;
+
+private:
+	// Copies the cached invariants of the other stroke, which has the same points, except the cumulative lengths.
+	void CopyInvariants(const Stroke& other);
+
+	// Discards the cached invariants.
+	void InvalidateInvariants();
 
+	// Computes the cumulative lengths if they are not cached.
+	void BuildArcLengths() const;
+
+    // The points of the stroke.
+    std::pmr::vector<Vector2> points;
+
+	// The cached invariants, valid only if the respective flag is set.
+	mutable Vector2 cachedCentroid;
+	mutable Vector2 cachedTopLeftCorner;
+	mutable Vector2 cachedBottomRightCorner;
+	mutable float cachedPathLength = 0.0f;
+	mutable float cachedIndicativeAngle = 0.0f;
+
+	// The length of the path up to each point, allocated from the memory resource of the stroke.
+	mutable std::pmr::vector<float> cachedArcLengths;
+
+	mutable bool hasCentroid = false;
+	mutable bool hasBoundingBox = false;
+	mutable bool hasPathLength = false;
+	mutable bool hasIndicativeAngle = false;
+	mutable bool hasArcLengths = false;
+};
@@ -0,0 +1,196 @@
+#include "StrokePipeline.h"
+#include <cmath>
+#include "Profiler.h"
+#include "WorkCounters.h"
+
+Vector2 AffineTransform::Apply(const Vector2& point) const
+{
+	return Vector2(a * point.x + b * point.y + c, d * point.x + e * point.y + f);
+}
+
+AffineTransform AffineTransform::Then(const AffineTransform& next) const
+{
+	AffineTransform product;
+	product.a = next.a * a + next.b * d;
+	product.b = next.a * b + next.b * e;
+	product.c = next.a * c + next.b * f + next.c;
+	product.d = next.d * a + next.e * d;
+	product.e = next.d * b + next.e * e;
+	product.f = next.d * c + next.e * f + next.f;
+
+	return product;
+}
+
+void ResamplePoints(const Stroke& stroke, int pointCount, Vector2* resampledPoints)
+{
+	PROFILE_STAGE(ProfileStage::Resample);
+
+	const std::pmr::vector<Vector2>& points = stroke.GetPoints();
+
+	if (points.size() == 0)
+		throw std::exception("Cannot resample the stroke: The stroke has no point.");
+
+	WorkCounters::GetThreadCounters().pointsTouched += points.size();
+
+	const float I = stroke.GetPathLength() / (pointCount - 1);
+	float D = 0;
+
+	// Same walk as Stroke::Resample, except that the new point becomes the start of the current segment instead of being inserted into a copy of the stroke.
+	resampledPoints[0] = points[0];
+	int resampledCount = 1;
+
+	Vector2 previousPoint = points[0];
+	int i = 1;
+	while (i < (int)points.size() && resampledCount < pointCount)
+	{
+		float d = Vector2::Distance(previousPoint, points[i]);
+
+		if (D + d >= I)
+		{
+			Vector2 newPoint;
+			newPoint.x = previousPoint.x + ((I - D) / d) * (points[i].x - previousPoint.x);
+			newPoint.y = previousPoint.y + ((I - D) / d) * (points[i].y - previousPoint.y);
+
+			resampledPoints[resampledCount++] = newPoint;
+			previousPoint = newPoint;
+
+			D = 0;
+		}
+		else
+		{
+			D += d;
+			previousPoint = points[i];
+			++i;
+		}
+	}
+
+	// The rounding errors may leave the last points out.
+	while (resampledCount < pointCount)
+		resampledPoints[resampledCount++] = points[points.size() - 1];
+}
+
+void TransformPoints(const Vector2* points, int pointCount, const AffineTransform& transform, Vector2* transformedPoints)
+{
+	WorkCounters::GetThreadCounters().pointsTouched += pointCount;
+
+	for (int i = 0; i < pointCount; ++i)
+		transformedPoints[i] = transform.Apply(points[i]);
+}
+
+void RotateStep::Compose(const Vector2*, int, const Vector2& centroid, AffineTransform& transform) const
+{
+	// The transforms are affine, so the centroid of the transformed points is the transformed centroid.
+	const Vector2 center = transform.Apply(centroid);
+	const float cosAngle = std::cos(angle);
+	const float sinAngle = std::sin(angle);
+
+	AffineTransform rotation;
+	rotation.a = cosAngle;
+	rotation.b = -sinAngle;
+	rotation.c = center.x - cosAngle * center.x + sinAngle * center.y;
+	rotation.d = sinAngle;
+	rotation.e = cosAngle;
+	rotation.f = center.y - sinAngle * center.x - cosAngle * center.y;
+
+	transform = transform.Then(rotation);
+}
+
+void RotateByIndicativeAngleStep::Compose(const Vector2* points, int pointCount, const Vector2& centroid, AffineTransform& transform) const
+{
+	if (pointCount < 2)
+		throw std::exception("Cannot find the indicative angle: The stroke must have at least 2 points.");
+
+	const Vector2 center = transform.Apply(centroid);
+	const Vector2 firstPoint = transform.Apply(points[0]);
+
+	RotateStep rotation;
+	rotation.angle = -std::atan2(center.y - firstPoint.y, center.x - firstPoint.x);
+	rotation.Compose(points, pointCount, centroid, transform);
+}
+
+void ScaleStep::Compose(const Vector2* points, int pointCount, const Vector2&, AffineTransform& transform) const
+{
+	PROFILE_STAGE(ProfileStage::ScaleTo);
+
+	if (pointCount == 0)
+		throw std::exception("Cannot scale the stroke: The stroke has no point.");
+
+	WorkCounters::GetThreadCounters().pointsTouched += pointCount;
+
+	// The bounding box is not affine, so it is found on the transformed points, without storing them.
+	// Only the coordinates are transformed in the loop, and the comparisons are the ones of Stroke::ScaleTo, which compile to min and max instructions, unlike fmin and fmax.
+	const float a = transform.a, b = transform.b, c = transform.c;
+	const float d = transform.d, e = transform.e, f = transform.f;
+
+	float minX = a * points[0].x + b * points[0].y + c;
+	float minY = d * points[0].x + e * points[0].y + f;
+	float maxX = minX;
+	float maxY = minY;
+
+	for (int i = 1; i < pointCount; ++i)
+	{
+		const float x = a * points[i].x + b * points[i].y + c;
+		const float y = d * points[i].x + e * points[i].y + f;
+
+		minX = x < minX ? x : minX;
+		minY = y < minY ? y : minY;
+		maxX = x > maxX ? x : maxX;
+		maxY = y > maxY ? y : maxY;
+	}
+
+	AffineTransform scaling;
+	scaling.a = size / (maxX - minX);
+	scaling.e = size / (maxY - minY);
+
+	transform = transform.Then(scaling);
+}
+
+void TranslateStep::Compose(const Vector2*, int, const Vector2& centroid, AffineTransform& transform) const
+{
+	const Vector2 displacementToOrigin = origin - transform.Apply(centroid);
+
+	AffineTransform translation;
+	translation.c = displacementToOrigin.x;
+	translation.f = displacementToOrigin.y;
+
+	transform = transform.Then(translation);
+}
+
+StrokeSource::StrokeSource(const Stroke& stroke, int resampleCount):stroke(stroke), resampleCount(resampleCount) {}
+
+int StrokeSource::GetPointCount() const
+{
+	return resampleCount > 0 ? resampleCount : stroke.GetPointCount();
+}
+
+const Vector2* StrokeSource::LoadPoints(Vector2* buffer) const
+{
+	if (resampleCount == 0)
+		return stroke.GetPoints().data();
+
+	ResamplePoints(stroke, resampleCount, buffer);
+	return buffer;
+}
+
+Vector2 StrokeSource::GetCentroid(const Vector2* points) const
+{
+	if (resampleCount == 0)
+		return stroke.GetCentroid();
+
+	float sumX = 0;
+	float sumY = 0;
+	for (int i = 0; i < resampleCount; ++i)
+	{
+		sumX += points[i].x;
+		sumY += points[i].y;
+	}
+
+	return Vector2(sumX / resampleCount, sumY / resampleCount);
+}
+
+void StrokeSource::Evaluate(Vector2* points) const
+{
+	const Vector2* sourcePoints = LoadPoints(points);
+	if (sourcePoints != points)
+		TransformPoints(sourcePoints, GetPointCount(), AffineTransform(), points);
+}
@@ -0,0 +1,163 @@
+// StrokePipeline.h
+// Programmer: Khoi Ho
+
+#pragma once
+
+#include <type_traits>
+#include "Stroke.h"
+#include "Vector2.h"
+
+// Builds a chain of transforms without creating a stroke per step, for example:
+//
+//     (stroke | Resample(64) | RotateByIndicativeAngle() | Scale(250) | Translate(Vector2())).Evaluate(points);
+//
+// The rotations, scalings and translations are composed into one affine transform, which is applied to the points in a single pass into the buffer of the caller.
+// The result is the same as the matching Stroke transforms up to rounding. A pipeline refers to the stroke, so it must not outlive it.
+
+// Maps (x, y) to (a x + b y + c, d x + e y + f).
+struct AffineTransform
+{
+	float a = 1.0f, b = 0.0f, c = 0.0f;
+	float d = 0.0f, e = 1.0f, f = 0.0f;
+
+	Vector2 Apply(const Vector2& point) const;
+
+	// Returns the transform that applies this transform, then the next one.
+	AffineTransform Then(const AffineTransform& next) const;
+};
+
+// Resamples the points of the stroke into pointCount evenly spaced points, as Stroke::Resample. The stroke must have at least 1 point.
+void ResamplePoints(const Stroke& stroke, int pointCount, Vector2* resampledPoints);
+
+// Writes the transformed points to transformedPoints, which may be the same buffer as points.
+void TransformPoints(const Vector2* points, int pointCount, const AffineTransform& transform, Vector2* transformedPoints);
+
+// The steps of a pipeline. Each affine step updates the transform from the points of the source, their centroid and the transform of the previous steps.
+
+// Resamples the stroke, as Stroke::Resample. It can only be the first step.
+struct ResampleStep
+{
+	int pointCount;
+};
+
+// Rotates by an angle around the centroid, as Stroke::RotateBy.
+struct RotateStep
+{
+	float angle;
+
+	void Compose(const Vector2* points, int pointCount, const Vector2& centroid, AffineTransform& transform) const;
+};
+
+// Rotates by the opposite of the indicative angle, as step 2 of the $1 recognizer.
+struct RotateByIndicativeAngleStep
+{
+	void Compose(const Vector2* points, int pointCount, const Vector2& centroid, AffineTransform& transform) const;
+};
+
+// Scales the bounding box to a square of the specified size, as Stroke::ScaleTo. It takes one more pass over the points to find the bounding box.
+struct ScaleStep
+{
+	int size;
+
+	void Compose(const Vector2* points, int pointCount, const Vector2& centroid, AffineTransform& transform) const;
+};
+
+// Translates the centroid to the origin, as Stroke::TranslateTo.
+struct TranslateStep
+{
+	Vector2 origin;
+
+	void Compose(const Vector2* points, int pointCount, const Vector2& centroid, AffineTransform& transform) const;
+};
+
+inline ResampleStep Resample(int pointCount = 64) { return ResampleStep{ pointCount }; }
+inline RotateStep Rotate(float angle) { return RotateStep{ angle }; }
+inline RotateByIndicativeAngleStep RotateByIndicativeAngle() { return RotateByIndicativeAngleStep(); }
+inline ScaleStep Scale(int size = 250) { return ScaleStep{ size }; }
+inline TranslateStep Translate(const Vector2& origin = Vector2()) { return TranslateStep{ origin }; }
+
+template <typename Step> struct IsAffineStep : std::false_type {};
+template <> struct IsAffineStep<RotateStep> : std::true_type {};
+template <> struct IsAffineStep<RotateByIndicativeAngleStep> : std::true_type {};
+template <> struct IsAffineStep<ScaleStep> : std::true_type {};
+template <> struct IsAffineStep<TranslateStep> : std::true_type {};
+
+// The points of a stroke, resampled or not. It is the first node of every pipeline.
+class StrokeSource
+{
+public:
+	StrokeSource(const Stroke& stroke, int resampleCount = 0);
+
+	int GetPointCount() const;
+
+	// Returns the points of the source. If the stroke is resampled, they are written to buffer, which must hold GetPointCount() points.
+	const Vector2* LoadPoints(Vector2* buffer) const;
+
+	// Returns the centroid of the loaded points. For the original points, it is the cached centroid of the stroke.
+	Vector2 GetCentroid(const Vector2* points) const;
+
+	void Compose(const Vector2*, int, const Vector2&, AffineTransform&) const {}
+
+	// Writes the points to the buffer, which must hold GetPointCount() points.
+	void Evaluate(Vector2* points) const;
+
+private:
+	const Stroke& stroke;
+	int resampleCount;
+};
+
+// A pipeline whose last step is Step. The steps are composed at compile time, so the evaluation has no virtual call and no allocation.
+template <typename Inner, typename Step>
+class TransformedStroke
+{
+public:
+	TransformedStroke(const Inner& inner, const Step& step) :inner(inner), step(step) {}
+
+	int GetPointCount() const { return inner.GetPointCount(); }
+	const Vector2* LoadPoints(Vector2* buffer) const { return inner.LoadPoints(buffer); }
+	Vector2 GetCentroid(const Vector2* points) const { return inner.GetCentroid(points); }
+
+	void Compose(const Vector2* points, int pointCount, const Vector2& centroid, AffineTransform& transform) const
+	{
+		inner.Compose(points, pointCount, centroid, transform);
+		step.Compose(points, pointCount, centroid, transform);
+	}
+
+	// Writes the transformed points to the buffer, which must hold GetPointCount() points.
+	void Evaluate(Vector2* points) const
+	{
+		const Vector2* sourcePoints = LoadPoints(points);
+		const int pointCount = GetPointCount();
+
+		AffineTransform transform;
+		Compose(sourcePoints, pointCount, GetCentroid(sourcePoints), transform);
+		TransformPoints(sourcePoints, pointCount, transform, points);
+	}
+
+private:
+	Inner inner;
+	Step step;
+};
+
+inline StrokeSource operator|(const Stroke& stroke, const ResampleStep& step)
+{
+	return StrokeSource(stroke, step.pointCount);
+}
+
+template <typename Step, typename = std::enable_if_t<IsAffineStep<Step>::value>>
+TransformedStroke<StrokeSource, Step> operator|(const Stroke& stroke, const Step& step)
+{
+	return TransformedStroke<StrokeSource, Step>(StrokeSource(stroke), step);
+}
+
+template <typename Step, typename = std::enable_if_t<IsAffineStep<Step>::value>>
+TransformedStroke<StrokeSource, Step> operator|(const StrokeSource& source, const Step& step)
+{
+	return TransformedStroke<StrokeSource, Step>(source, step);
+}
+
+template <typename Inner, typename Previous, typename Step, typename = std::enable_if_t<IsAffineStep<Step>::value>>
+TransformedStroke<TransformedStroke<Inner, Previous>, Step> operator|(const TransformedStroke<Inner, Previous>& pipeline, const Step& step)
+{
+	return TransformedStroke<TransformedStroke<Inner, Previous>, Step>(pipeline, step);
+}
@@ -0,0 +1,777 @@
+#include "TemplateBank.h"
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <utility>
+#include "AngleSearch.h"
+#include "Kernels.h"
+#include "ParallelFor.h"
+#include "PerfCounters.h"
+#include "Profiler.h"
+#include "Tracer.h"
+#include "WorkCounters.h"
+
+namespace
+{
+	// The rotations of the candidate at the probes of the angle search, computed on first use and shared by all the templates.
+	// Every search over the full range starts with the same 2 probes and most of them follow the same few paths, so the candidate is rotated far fewer times than there are templates.
+	class RotationCache
+	{
+	public:
+		RotationCache(const float* x, const float* y, int pointCount, const Vector2& centroid, int probeCount, std::pmr::memory_resource* resource)
+			:x(x), y(y), pointCount(pointCount), centroid(centroid), allocator(resource), rotations(probeCount, nullptr, resource), overflowRotation(2 * pointCount, resource)
+		{}
+
+		RotationCache(const RotationCache&) = delete;
+		RotationCache& operator=(const RotationCache&) = delete;
+
+		~RotationCache()
+		{
+			for (float* rotation : rotations)
+			{
+				if (rotation != nullptr)
+					allocator.deallocate(rotation, 2 * pointCount);
+			}
+		}
+
+		// Returns the candidate rotated by the angle of the probe: the x coordinates, followed by the y coordinates.
+		const float* GetRotation(int probe, float angle)
+		{
+			float* rotation;
+
+			if (probe < (int)rotations.size())
+			{
+				if (rotations[probe] != nullptr)
+					return rotations[probe];
+
+				rotation = rotations[probe] = allocator.allocate(2 * pointCount);
+			}
+			else
+				rotation = overflowRotation.data();
+
+			WorkCounters& workCounters = WorkCounters::GetThreadCounters();
+			++workCounters.rotations;
+			workCounters.pointsTouched += 2 * pointCount;
+
+			RotatePoints(x, y, pointCount, angle, centroid.x, centroid.y, rotation, rotation + pointCount);
+			return rotation;
+		}
+
+	private:
+		const float* x;
+		const float* y;
+		int pointCount;
+		Vector2 centroid;
+
+		std::pmr::polymorphic_allocator<float> allocator;
+		std::pmr::vector<float*> rotations;
+
+		// Used if the search goes deeper than expected because of rounding errors.
+		std::pmr::vector<float> overflowRotation;
+	};
+}
+
+TemplateBank::TemplateBank(int pointCount, int size):pointCount(pointCount), size(size) {}
+
+void TemplateBank::Build(const std::vector<Stroke>& strokes)
+{
+	const int templateCount = strokes.size();
+
+	// Every template is written to its own slots, so the templates are preprocessed in parallel and the result is the same as in serial.
+	names.assign(templateCount, std::string());
+	features.assign(templateCount, StrokeFeatures());
+	xs.assign(templateCount * pointCount, 0.0f);
+	ys.assign(templateCount * pointCount, 0.0f);
+
+	ParallelFor(templateCount, [&](int i)
+	{
+		TRACE_SCOPE("PreprocessTemplate", "preprocessing");
+		PERF_SCOPE(PerfStage::PreprocessTemplate);
+
+		// The same steps as Stroke::Normalize, with the features taken from the rotated stroke instead of resampling and rotating it again.
+		Stroke rotatedStroke = strokes[i].Resample(pointCount);
+		const float indicativeAngle = rotatedStroke.GetIndicativeAngle();
+		rotatedStroke = std::move(rotatedStroke).RotateBy(-indicativeAngle);
+		features[i] = rotatedStroke.GetFeaturesOfRotatedStroke();
+
+		Stroke normalizedStroke = std::move(rotatedStroke).ScaleTo(size).TranslateTo();
+
+		names[i].assign(normalizedStroke.name.begin(), normalizedStroke.name.end());
+
+		for (int j = 0; j < pointCount; ++j)
+		{
+			xs[i * pointCount + j] = normalizedStroke.GetPoint(j).x;
+			ys[i * pointCount + j] = normalizedStroke.GetPoint(j).y;
+		}
+	});
+
+	BuildClasses();
+	BuildRotationTable();
+	BuildInterleavedTemplates();
+	BuildClassPrototypes();
+	BuildFeatureBounds();
+}
+
+void TemplateBank::Load(int templateCount, const char* const* templateNames, const float* templateXs, const float* templateYs, const StrokeFeatures* templateFeatures)
+{
+	names.assign(templateNames, templateNames + templateCount);
+	features.assign(templateFeatures, templateFeatures + templateCount);
+	xs.assign(templateXs, templateXs + templateCount * pointCount);
+	ys.assign(templateYs, templateYs + templateCount * pointCount);
+
+	BuildClasses();
+	BuildRotationTable();
+	BuildInterleavedTemplates();
+	BuildClassPrototypes();
+	BuildFeatureBounds();
+}
+
+void TemplateBank::SetRotationTable(float angleStep, bool refine)
+{
+	rotationStep = angleStep;
+	refineRotation = refine;
+
+	BuildRotationTable();
+}
+
+int TemplateBank::GetRotationCount() const
+{
+	return rotationCount;
+}
+
+void TemplateBank::SetAngleSearchMethod(AngleSearchMethod method)
+{
+	angleSearchMethod = method;
+}
+
+void TemplateBank::SetLayout(TemplateLayout newLayout)
+{
+	if (newLayout == layout)
+		return;
+
+	// Move the templates back to the per-template arrays, then to the arrays of the new layout.
+	if (layout == TemplateLayout::Interleaved)
+	{
+		const int templateCount = GetTemplateCount();
+		xs.assign(templateCount * pointCount, 0.0f);
+		ys.assign(templateCount * pointCount, 0.0f);
+
+		for (int i = 0; i < templateCount; ++i)
+		{
+			LoadX(i, xs.data() + i * pointCount);
+			LoadY(i, ys.data() + i * pointCount);
+		}
+
+		std::vector<float>().swap(interleavedXs);
+		std::vector<float>().swap(interleavedYs);
+	}
+
+	layout = newLayout;
+
+	BuildInterleavedTemplates();
+}
+
+void TemplateBank::SetClassFilter(int classCount)
+{
+	classFilterCount = classCount;
+
+	BuildClassPrototypes();
+}
+
+int TemplateBank::GetClassCount() const
+{
+	return classTemplates.size();
+}
+
+void TemplateBank::SetFeatureCascade(float tolerance)
+{
+	featureTolerance = tolerance;
+
+	BuildFeatureBounds();
+}
+
+void TemplateBank::BuildClasses()
+{
+	classTemplates.clear();
+	templateClasses.assign(GetTemplateCount(), 0);
+
+	// Group the samples by name, in the order of their first sample.
+	std::map<std::string, int> classIndices;
+	for (int i = 0; i < GetTemplateCount(); ++i)
+	{
+		std::map<std::string, int>::iterator classIndex = classIndices.find(names[i]);
+		if (classIndex == classIndices.end())
+		{
+			classIndex = classIndices.insert(std::make_pair(names[i], (int)classTemplates.size())).first;
+			classTemplates.push_back(std::vector<int>());
+		}
+
+		classTemplates[classIndex->second].push_back(i);
+		templateClasses[i] = classIndex->second;
+	}
+}
+
+void TemplateBank::BuildFeatureBounds()
+{
+	// How far the features of a candidate may be from those of a name with a single sample, at a tolerance of 1.
+	static const float FEATURE_SPREADS[(int)StrokeFeature::Count] = { 0.5f, 0.5f, 0.5f, 0.5f, 0.15f };
+
+	classFeatureMinimums.clear();
+	classFeatureMaximums.clear();
+
+	if (featureTolerance <= 0.0f)
+		return;
+
+	// Accept the range of the samples of each name, widened in proportion to the range and the tolerance.
+	for (const std::vector<int>& samples : classTemplates)
+	{
+		StrokeFeatures minimums = features[samples[0]];
+		StrokeFeatures maximums = features[samples[0]];
+
+		for (int i : samples)
+		{
+			for (int f = 0; f < (int)StrokeFeature::Count; ++f)
+			{
+				minimums.values[f] = std::fmin(minimums.values[f], features[i].values[f]);
+				maximums.values[f] = std::fmax(maximums.values[f], features[i].values[f]);
+			}
+		}
+
+		for (int f = 0; f < (int)StrokeFeature::Count; ++f)
+		{
+			const float margin = featureTolerance * (maximums.values[f] - minimums.values[f] + FEATURE_SPREADS[f]);
+			minimums.values[f] -= margin;
+			maximums.values[f] += margin;
+		}
+
+		classFeatureMinimums.push_back(minimums);
+		classFeatureMaximums.push_back(maximums);
+	}
+}
+
+bool TemplateBank::AreFeaturesAccepted(int classIndex, const StrokeFeatures& candidateFeatures) const
+{
+	for (int f = 0; f < (int)StrokeFeature::Count; ++f)
+	{
+		if (candidateFeatures.values[f] < classFeatureMinimums[classIndex].values[f] || candidateFeatures.values[f] > classFeatureMaximums[classIndex].values[f])
+			return false;
+	}
+
+	return true;
+}
+
+void TemplateBank::BuildClassPrototypes()
+{
+	classMedoids.clear();
+
+	if (classFilterCount <= 0)
+		return;
+
+	// The buffers only hold the gathered points of the interleaved layout.
+	std::vector<float> sampleXBuffer(pointCount);
+	std::vector<float> sampleYBuffer(pointCount);
+	std::vector<float> otherXBuffer(pointCount);
+	std::vector<float> otherYBuffer(pointCount);
+
+	// The medoid is the sample with the smallest total distance to the other samples of its class.
+	// The samples are already rotated by their indicative angle, so they are compared without the search for the best angle.
+	for (const std::vector<int>& samples : classTemplates)
+	{
+		int medoid = samples[0];
+		float medoidDistance = std::numeric_limits<float>::infinity();
+
+		for (int i : samples)
+		{
+			const float* sampleX = LoadX(i, sampleXBuffer.data());
+			const float* sampleY = LoadY(i, sampleYBuffer.data());
+
+			float totalDistance = 0.0f;
+			for (int j : samples)
+				totalDistance += GetPathDistance(sampleX, sampleY, LoadX(j, otherXBuffer.data()), LoadY(j, otherYBuffer.data()), pointCount);
+
+			if (totalDistance < medoidDistance)
+			{
+				medoidDistance = totalDistance;
+				medoid = i;
+			}
+		}
+
+		classMedoids.push_back(medoid);
+	}
+}
+
+void TemplateBank::BuildInterleavedTemplates()
+{
+	interleavedXs.clear();
+	interleavedYs.clear();
+
+	if (layout != TemplateLayout::Interleaved)
+		return;
+
+	const int templateCount = GetTemplateCount();
+
+	const int blockCount = (templateCount + TEMPLATE_LANES - 1) / TEMPLATE_LANES;
+	interleavedXs.assign(blockCount * pointCount * TEMPLATE_LANES, 0.0f);
+	interleavedYs.assign(blockCount * pointCount * TEMPLATE_LANES, 0.0f);
+
+	for (int block = 0; block < blockCount; ++block)
+	{
+		for (int k = 0; k < TEMPLATE_LANES; ++k)
+		{
+			const int index = std::min(block * TEMPLATE_LANES + k, templateCount - 1);
+			const float* templateX = xs.data() + index * pointCount;
+			const float* templateY = ys.data() + index * pointCount;
+
+			for (int j = 0; j < pointCount; ++j)
+			{
+				interleavedXs[(block * pointCount + j) * TEMPLATE_LANES + k] = templateX[j];
+				interleavedYs[(block * pointCount + j) * TEMPLATE_LANES + k] = templateY[j];
+			}
+		}
+	}
+
+	std::vector<float>().swap(xs);
+	std::vector<float>().swap(ys);
+}
+
+const float* TemplateBank::LoadX(int index, float* buffer) const
+{
+	if (layout != TemplateLayout::Interleaved)
+		return xs.data() + index * pointCount;
+
+	const float* blockX = interleavedXs.data() + (index / TEMPLATE_LANES) * pointCount * TEMPLATE_LANES + index % TEMPLATE_LANES;
+	for (int j = 0; j < pointCount; ++j)
+		buffer[j] = blockX[j * TEMPLATE_LANES];
+
+	return buffer;
+}
+
+const float* TemplateBank::LoadY(int index, float* buffer) const
+{
+	if (layout != TemplateLayout::Interleaved)
+		return ys.data() + index * pointCount;
+
+	const float* blockY = interleavedYs.data() + (index / TEMPLATE_LANES) * pointCount * TEMPLATE_LANES + index % TEMPLATE_LANES;
+	for (int j = 0; j < pointCount; ++j)
+		buffer[j] = blockY[j * TEMPLATE_LANES];
+
+	return buffer;
+}
+
+void TemplateBank::BuildRotationTable()
+{
+	rotationAngles.clear();
+
+	if (rotationStep > 0.0f)
+	{
+		// Include both ends of the range, like the golden-section search can.
+		for (float angle = ANGLE_ALPHA; angle < ANGLE_BETA + 0.5f * rotationStep; angle += rotationStep)
+			rotationAngles.push_back(angle < ANGLE_BETA ? angle : ANGLE_BETA);
+	}
+
+	rotationCount = rotationAngles.size();
+
+	const int templateCount = GetTemplateCount();
+	rotatedXs.assign(templateCount * rotationCount * pointCount, 0.0f);
+	rotatedYs.assign(templateCount * rotationCount * pointCount, 0.0f);
+
+	if (rotationCount == 0)
+		return;
+
+	std::vector<float> templateXBuffer(pointCount);
+	std::vector<float> templateYBuffer(pointCount);
+
+	for (int i = 0; i < templateCount; ++i)
+	{
+		const float* templateX = LoadX(i, templateXBuffer.data());
+		const float* templateY = LoadY(i, templateYBuffer.data());
+
+		Vector2 centroid;
+		for (int j = 0; j < pointCount; ++j)
+		{
+			centroid.x += templateX[j];
+			centroid.y += templateY[j];
+		}
+		centroid.x /= pointCount;
+		centroid.y /= pointCount;
+
+		// Rotating the template by -angle is the same as rotating the candidate by angle, since both are centered at the origin.
+		for (int k = 0; k < rotationCount; ++k)
+		{
+			const int offset = (i * rotationCount + k) * pointCount;
+			RotatePoints(templateX, templateY, pointCount, -rotationAngles[k], centroid.x, centroid.y, rotatedXs.data() + offset, rotatedYs.data() + offset);
+		}
+	}
+}
+
+int TemplateBank::GetTemplateCount() const
+{
+	return names.size();
+}
+
+int TemplateBank::GetPointCount() const
+{
+	return pointCount;
+}
+
+int TemplateBank::GetSize() const
+{
+	return size;
+}
+
+const std::string& TemplateBank::GetName(int index) const
+{
+	return names[index];
+}
+
+const float* TemplateBank::GetX(int index) const
+{
+	if (layout == TemplateLayout::Interleaved)
+		throw std::exception("Cannot get the coordinates of the template: The templates are interleaved.");
+
+	return xs.data() + index * pointCount;
+}
+
+const float* TemplateBank::GetY(int index) const
+{
+	if (layout == TemplateLayout::Interleaved)
+		throw std::exception("Cannot get the coordinates of the template: The templates are interleaved.");
+
+	return ys.data() + index * pointCount;
+}
+
+const StrokeFeatures& TemplateBank::GetFeatures(int index) const
+{
+	return features[index];
+}
+
+size_t TemplateBank::GetMemoryUsage() const
+{
+	return (xs.size() + ys.size() + rotatedXs.size() + rotatedYs.size() + interleavedXs.size() + interleavedYs.size()) * sizeof(float);
+}
+
+float TemplateBank::GetDistanceAtBestAngle(const float* templateX, const float* templateY, const float* candidateX, const float* candidateY, const Vector2& centroid, float* rotatedX, float* rotatedY, float angleAlpha, float angleBeta) const
+{
+	WorkCounters& workCounters = WorkCounters::GetThreadCounters();
+
+	return SearchBestAngle([&](float angle)
+	{
+		++workCounters.rotations;
+		workCounters.pointsTouched += 2 * pointCount;
+
+		RotatePoints(candidateX, candidateY, pointCount, angle, centroid.x, centroid.y, rotatedX, rotatedY);
+		return GetPathDistance(rotatedX, rotatedY, templateX, templateY, pointCount);
+	}, angleAlpha, angleBeta, ANGLE_DELTA);
+}
+
+float TemplateBank::GetDistanceFromRotationTable(int index, const float* templateX, const float* templateY, const float* candidateX, const float* candidateY, const Vector2& centroid, float* rotatedX, float* rotatedY) const
+{
+	WorkCounters& workCounters = WorkCounters::GetThreadCounters();
+
+	float bestDistance = std::numeric_limits<float>::infinity();
+	int bestRotation = 0;
+
+	for (int k = 0; k < rotationCount; ++k)
+	{
+		const int offset = (index * rotationCount + k) * pointCount;
+
+		float distance = GetPathDistance(candidateX, candidateY, rotatedXs.data() + offset, rotatedYs.data() + offset, pointCount);
+		if (distance < bestDistance)
+		{
+			bestDistance = distance;
+			bestRotation = k;
+		}
+	}
+
+	workCounters.distanceEvaluations += rotationCount;
+	workCounters.pointsTouched += 2 * rotationCount * pointCount;
+
+	if (!refineRotation)
+		return bestDistance;
+
+	// Search around the best stored angle, rotating the candidate as without the table.
+	const float angleAlpha = std::fmax(ANGLE_ALPHA, rotationAngles[bestRotation] - rotationStep);
+	const float angleBeta = std::fmin(ANGLE_BETA, rotationAngles[bestRotation] + rotationStep);
+	float refinedDistance = GetDistanceAtBestAngle(templateX, templateY, candidateX, candidateY, centroid, rotatedX, rotatedY, angleAlpha, angleBeta);
+
+	return refinedDistance < bestDistance ? refinedDistance : bestDistance;
+}
+
+void TemplateBank::GetDistancesToBlock(int block, const float* candidateX, const float* candidateY, const Vector2& centroid, float* distances) const
+{
+	static const float phi = 0.5f * (-1.0f + std::sqrt(5.0f));
+
+	WorkCounters& workCounters = WorkCounters::GetThreadCounters();
+	const int laneCount = std::min(TEMPLATE_LANES, GetTemplateCount() - block * TEMPLATE_LANES);
+
+	const float* templateX = interleavedXs.data() + block * pointCount * TEMPLATE_LANES;
+	const float* templateY = interleavedYs.data() + block * pointCount * TEMPLATE_LANES;
+
+	auto distancesAtAngles = [&](const float* angles, float* laneDistances)
+	{
+		workCounters.distanceEvaluations += laneCount;
+		workCounters.rotations += laneCount;
+		workCounters.pointsTouched += 2 * laneCount * pointCount;
+
+		GetPathDistancesToInterleavedTemplates(candidateX, candidateY, pointCount, angles, centroid.x, centroid.y, templateX, templateY, laneDistances);
+	};
+
+	// The same steps as SearchBestAngle, with one search per lane.
+	float angleAlpha[TEMPLATE_LANES];
+	float angleBeta[TEMPLATE_LANES];
+	float x1[TEMPLATE_LANES];
+	float x2[TEMPLATE_LANES];
+	float f1[TEMPLATE_LANES];
+	float f2[TEMPLATE_LANES];
+
+	for (int k = 0; k < TEMPLATE_LANES; ++k)
+	{
+		angleAlpha[k] = ANGLE_ALPHA;
+		angleBeta[k] = ANGLE_BETA;
+		x1[k] = phi * ANGLE_ALPHA + (1.0f - phi) * ANGLE_BETA;
+		x2[k] = (1.0f - phi) * ANGLE_ALPHA + phi * ANGLE_BETA;
+	}
+
+	distancesAtAngles(x1, f1);
+	distancesAtAngles(x2, f2);
+
+	float angles[TEMPLATE_LANES];
+	float newDistances[TEMPLATE_LANES];
+	bool isLeft[TEMPLATE_LANES];
+	bool isActive[TEMPLATE_LANES];
+
+	while (true)
+	{
+		// The brackets shrink at the same rate, but a lane stops as soon as its own bracket is small enough, as SearchBestAngle would.
+		bool isAnyActive = false;
+
+		for (int k = 0; k < TEMPLATE_LANES; ++k)
+		{
+			isActive[k] = std::abs(angleBeta[k] - angleAlpha[k]) > ANGLE_DELTA;
+			isLeft[k] = f1[k] < f2[k];
+
+			if (!isActive[k])
+				angles[k] = x1[k];
+
+			else if (isLeft[k])
+			{
+				isAnyActive = true;
+				angleBeta[k] = x2[k];
+				x2[k] = x1[k];
+				f2[k] = f1[k];
+				x1[k] = phi * angleAlpha[k] + (1.0f - phi) * angleBeta[k];
+				angles[k] = x1[k];
+			}
+			else
+			{
+				isAnyActive = true;
+				angleAlpha[k] = x1[k];
+				x1[k] = x2[k];
+				f1[k] = f2[k];
+				x2[k] = (1.0f - phi) * angleAlpha[k] + phi * angleBeta[k];
+				angles[k] = x2[k];
+			}
+		}
+
+		if (!isAnyActive)
+			break;
+
+		workCounters.angleSearchIterations += laneCount;
+		distancesAtAngles(angles, newDistances);
+
+		for (int k = 0; k < TEMPLATE_LANES; ++k)
+		{
+			if (!isActive[k])
+				continue;
+
+			if (isLeft[k])
+				f1[k] = newDistances[k];
+			else
+				f2[k] = newDistances[k];
+		}
+	}
+
+	for (int k = 0; k < TEMPLATE_LANES; ++k)
+		distances[k] = f1[k] < f2[k] ? f1[k] : f2[k];
+}
+
+void TemplateBank::Recognize(const Stroke& candidate, int& matchingIndex, float& score, std::pmr::memory_resource* resource) const
+{
+	RecognizeTemplates(candidate, nullptr, true, nullptr, GetTemplateCount(), matchingIndex, score, resource);
+}
+
+void TemplateBank::Recognize(const Stroke& candidate, const StrokeFeatures& candidateFeatures, int& matchingIndex, float& score, std::pmr::memory_resource* resource) const
+{
+	RecognizeTemplates(candidate, &candidateFeatures, true, nullptr, GetTemplateCount(), matchingIndex, score, resource);
+}
+
+void TemplateBank::RecognizeAmong(const Stroke& candidate, const int* indices, int indexCount, int& matchingIndex, float& score, std::pmr::memory_resource* resource) const
+{
+	RecognizeTemplates(candidate, nullptr, false, indices, indexCount, matchingIndex, score, resource);
+}
+
+void TemplateBank::RecognizeTemplates(const Stroke& candidate, const StrokeFeatures* candidateFeatures, bool isAllTemplates, const int* indices, int indexCount, int& matchingIndex, float& score, std::pmr::memory_resource* resource) const
+{
+	PROFILE_STAGE(ProfileStage::Recognize);
+	TRACE_SCOPE("Recognize", "recognition");
+	PERF_SCOPE(PerfStage::Recognize);
+
+	if (candidate.GetPointCount() != pointCount)
+		throw std::exception("Cannot recognize the stroke: The stroke must be resampled into as many points as the templates.");
+
+	// Remember the work done so far, so that the work of this recognition can be measured.
+	WorkCounters& workCounters = WorkCounters::GetThreadCounters();
+	const WorkCounters workCountersBefore = workCounters;
+
+	// Split the candidate into x and y coordinates. The rotated candidate of the refinement is allocated once and reused for every template.
+	std::pmr::vector<float> candidateX(pointCount, resource);
+	std::pmr::vector<float> candidateY(pointCount, resource);
+	std::pmr::vector<float> rotatedX(pointCount, resource);
+	std::pmr::vector<float> rotatedY(pointCount, resource);
+
+	// Only the interleaved layout gathers the points of a template into these buffers.
+	std::pmr::vector<float> templateXBuffer(pointCount, resource);
+	std::pmr::vector<float> templateYBuffer(pointCount, resource);
+
+	for (int i = 0; i < pointCount; ++i)
+	{
+		candidateX[i] = candidate.GetPoint(i).x;
+		candidateY[i] = candidate.GetPoint(i).y;
+	}
+
+	const Vector2 centroid = candidate.GetCentroid();
+
+	RotationCache rotationCache(candidateX.data(), candidateY.data(), pointCount, centroid, GetAngleSearchProbeCount(ANGLE_ALPHA, ANGLE_BETA, ANGLE_DELTA), resource);
+
+	float bestDistance = std::numeric_limits<float>::infinity();
+	matchingIndex = -1;
+
+	// Returns the distance between the candidate and template i at the best angle.
+	auto getDistance = [&](int i)
+	{
+		PROFILE_STAGE(ProfileStage::AngleSearch);
+
+		const float* templateX = LoadX(i, templateXBuffer.data());
+		const float* templateY = LoadY(i, templateYBuffer.data());
+
+		if (rotationCount > 0)
+			return GetDistanceFromRotationTable(i, templateX, templateY, candidateX.data(), candidateY.data(), centroid, rotatedX.data(), rotatedY.data());
+
+		if (angleSearchMethod == AngleSearchMethod::ParallelBracketing)
+		{
+			return SearchBestAngleInParallel([&](const float* angles, float* distances)
+			{
+				workCounters.rotations += ANGLE_LANES;
+				workCounters.pointsTouched += 2 * ANGLE_LANES * pointCount;
+
+				GetPathDistancesAtAngles(candidateX.data(), candidateY.data(), pointCount, angles, centroid.x, centroid.y, templateX, templateY, distances);
+			}, ANGLE_ALPHA, ANGLE_BETA, ANGLE_DELTA);
+		}
+
+		return SearchBestAngleByProbe([&](float angle, int probe)
+		{
+			const float* rotation = rotationCache.GetRotation(probe, angle);
+			return GetPathDistance(rotation, rotation + pointCount, templateX, templateY, pointCount);
+		}, ANGLE_ALPHA, ANGLE_BETA, ANGLE_DELTA);
+	};
+
+	// First, reject the names whose features are too far from those of the candidate.
+	// If every name is rejected, the features are not reliable enough and the candidate is compared with all of them.
+	std::pmr::vector<char> isClassRejected(resource);
+	if (candidateFeatures != nullptr && featureTolerance > 0.0f)
+	{
+		isClassRejected.assign(classTemplates.size(), false);
+
+		bool isAnyAccepted = false;
+		for (int c = 0; c < (int)classTemplates.size(); ++c)
+		{
+			isClassRejected[c] = !AreFeaturesAccepted(c, *candidateFeatures);
+			if (!isClassRejected[c])
+				isAnyAccepted = true;
+		}
+
+		if (!isAnyAccepted)
+			isClassRejected.clear();
+	}
+
+	std::pmr::vector<int> filteredIndices(resource);
+	if (isAllTemplates && classFilterCount > 0 && classFilterCount < (int)classMedoids.size())
+	{
+		// Rank the remaining names by the distance to their medoids, then only compare the candidate with the samples of the best names.
+		std::pmr::vector<std::pair<float, int>> classDistances(resource);
+		classDistances.reserve(classMedoids.size());
+		for (int c = 0; c < (int)classMedoids.size(); ++c)
+		{
+			if (isClassRejected.empty() || !isClassRejected[c])
+				classDistances.push_back(std::make_pair(getDistance(classMedoids[c]), c));
+		}
+
+		const int selectedCount = std::min(classFilterCount, (int)classDistances.size());
+		std::partial_sort(classDistances.begin(), classDistances.begin() + selectedCount, classDistances.end());
+
+		for (int c = 0; c < selectedCount; ++c)
+		{
+			const std::vector<int>& samples = classTemplates[classDistances[c].second];
+			filteredIndices.insert(filteredIndices.end(), samples.begin(), samples.end());
+		}
+
+		indices = filteredIndices.data();
+		indexCount = filteredIndices.size();
+		isAllTemplates = false;
+	}
+	else if (!isClassRejected.empty())
+	{
+		for (int n = 0; n < indexCount; ++n)
+		{
+			const int i = isAllTemplates ? n : indices[n];
+			if (!isClassRejected[templateClasses[i]])
+				filteredIndices.push_back(i);
+		}
+
+		indices = filteredIndices.data();
+		indexCount = filteredIndices.size();
+		isAllTemplates = false;
+	}
+
+	const int templateCount = GetTemplateCount();
+	workCounters.templatesSkipped += templateCount - indexCount;
+
+	if (isAllTemplates && rotationCount == 0 && layout == TemplateLayout::Interleaved)
+	{
+		const int blockCount = (templateCount + TEMPLATE_LANES - 1) / TEMPLATE_LANES;
+		for (int block = 0; block < blockCount; ++block)
+		{
+			PROFILE_STAGE(ProfileStage::AngleSearch);
+
+			float distances[TEMPLATE_LANES];
+			GetDistancesToBlock(block, candidateX.data(), candidateY.data(), centroid, distances);
+
+			for (int k = 0; k < TEMPLATE_LANES && block * TEMPLATE_LANES + k < templateCount; ++k)
+			{
+				if (distances[k] < bestDistance)
+				{
+					bestDistance = distances[k];
+					matchingIndex = block * TEMPLATE_LANES + k;
+				}
+			}
+		}
+	}
+	else
+	{
+		for (int n = 0; n < indexCount; ++n)
+		{
+			const int i = isAllTemplates ? n : indices[n];
+
+			float distance = getDistance(i);
+			if (distance < bestDistance)
+			{
+				bestDistance = distance;
+				matchingIndex = i;
+			}
+		}
+	}
+
+	score = 1.0f - bestDistance / (0.5f * std::sqrt((float)(size * size + size * size)));
+
+	WorkCounters::AddRecognition(workCounters - workCountersBefore);
+}
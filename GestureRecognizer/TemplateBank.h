@@ -0,0 +1,176 @@
+// TemplateBank.h
+// Programmer: Khoi Ho
+
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+#include <vector>
+#include "Stroke.h"
+
+// The algorithms that can find the best angle between the candidate and a template.
+enum class AngleSearchMethod
+{
+	// The golden-section search of the $1 paper, which evaluates one angle per step.
+	GoldenSection,
+
+	// Evaluates ANGLE_LANES evenly spaced angles per step with GetPathDistancesAtAngles, then narrows the range around the best one.
+	ParallelBracketing
+};
+
+// The layouts of the templates that the recognition can read.
+enum class TemplateLayout
+{
+	// The points of each template are contiguous. The candidate is compared with one template at a time.
+	PerTemplate,
+
+	// The points of TEMPLATE_LANES templates are interleaved, so that the candidate is compared with all of them at once, each one at its own angle.
+	// The templates are only stored interleaved, so the searches that read one template at a time gather its points first.
+	Interleaved
+};
+
+// Stores the preprocessed templates in flat arrays, so that the recognition reads them sequentially instead of chasing one vector per stroke.
+// The x coordinates of template i are xs[i * pointCount] to xs[(i + 1) * pointCount - 1], and likewise for the y coordinates.
+class TemplateBank
+{
+public:
+	// The templates are resampled into pointCount points and scaled to a square of the specified size.
+	TemplateBank(int pointCount = 64, int size = 250);
+
+	// Preprocesses the strokes (resample, rotate, scale and translate) on all the hardware threads and replaces the templates with them.
+	void Build(const std::vector<Stroke>& strokes);
+
+	// Replaces the templates with ones that are already preprocessed, such as the ones compiled into the program by --generate-header (see TemplateHeader.h).
+	// The points of template i are templateXs[i * pointCount] to templateXs[(i + 1) * pointCount - 1], as in the bank, and its features are templateFeatures[i].
+	void Load(int templateCount, const char* const* templateNames, const float* templateXs, const float* templateYs, const StrokeFeatures* templateFeatures);
+
+	// Stores each template rotated at every angleStep radians between ANGLE_ALPHA and ANGLE_BETA, so that the recognition compares the candidate with the stored rotations instead of rotating the candidate.
+	// If refine is true, the best stored rotation is refined with a golden-section search between the neighboring angles.
+	// A smaller step uses more memory and is more accurate. An angle step of 0 disables the table.
+	void SetRotationTable(float angleStep, bool refine = true);
+
+	int GetRotationCount() const;
+
+	// Selects the search for the best angle when there is no rotation table.
+	void SetAngleSearchMethod(AngleSearchMethod method);
+
+	// Computes the medoid of the samples of each name, so that the recognition compares the candidate with the medoids first,
+	// then only with the samples of the classCount closest names. A class count of 0 disables the filter.
+	void SetClassFilter(int classCount);
+
+	// Returns the number of different names.
+	int GetClassCount() const;
+
+	// Compares cheap features of the candidate (see StrokeFeatures) with the range of the features of the samples of each name, widened by the tolerance,
+	// and skips the names that are out of range before any search for the best angle. A tolerance of 0 disables the cascade.
+	// The cascade is only used when the features of the candidate are given to Recognize.
+	void SetFeatureCascade(float tolerance);
+
+	// Selects the layout in which the templates are stored and read by the recognition when there is no rotation table.
+	// The interleaved layout always uses the golden-section search.
+	void SetLayout(TemplateLayout newLayout);
+
+	int GetTemplateCount() const;
+	int GetPointCount() const;
+	int GetSize() const;
+
+	// Returns the name of a template.
+	const std::string& GetName(int index) const;
+
+	// Returns the x and y coordinates of the points of a template. The templates must be in the per-template layout.
+	const float* GetX(int index) const;
+	const float* GetY(int index) const;
+
+	// Returns the features of a template before preprocessing.
+	const StrokeFeatures& GetFeatures(int index) const;
+
+	// Returns the number of bytes used by the coordinates.
+	size_t GetMemoryUsage() const;
+
+	// Finds the template that matches the preprocessed candidate and returns its index (or -1 if the bank is empty) and the score.
+	// The temporary buffers are allocated from the memory resource.
+	void Recognize(const Stroke& candidate, int& matchingIndex, float& score, std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const;
+
+	// Same as above, with the features of the candidate before preprocessing (Stroke::GetFeatures) for the feature cascade.
+	void Recognize(const Stroke& candidate, const StrokeFeatures& candidateFeatures, int& matchingIndex, float& score, std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const;
+
+	// Finds the template that matches the preprocessed candidate among the templates with the specified indices, as Recognize.
+	// The other templates are counted as skipped. The class filter and the interleaved layout are only used by Recognize, which searches all the templates.
+	void RecognizeAmong(const Stroke& candidate, const int* indices, int indexCount, int& matchingIndex, float& score, std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const;
+
+private:
+	// Finds the template that matches the candidate among all the templates if isAllTemplates is true, or else among the templates with the specified indices,
+	// after rejecting the names with the feature cascade if candidateFeatures is not null.
+	void RecognizeTemplates(const Stroke& candidate, const StrokeFeatures* candidateFeatures, bool isAllTemplates, const int* indices, int indexCount, int& matchingIndex, float& score, std::pmr::memory_resource* resource) const;
+
+	// Groups the templates by name.
+	void BuildClasses();
+
+	// Computes the range of features accepted for each name if the feature cascade is enabled.
+	void BuildFeatureBounds();
+
+	// Returns true if the features are within the range accepted for the name.
+	bool AreFeaturesAccepted(int classIndex, const StrokeFeatures& candidateFeatures) const;
+
+	// Rotates the templates by the angles of the rotation table.
+	void BuildRotationTable();
+
+	// Finds the medoid of each name if the class filter is enabled.
+	void BuildClassPrototypes();
+
+	// Moves the templates from the per-template arrays to the interleaved ones if the interleaved layout is selected, so that only one copy is kept.
+	void BuildInterleavedTemplates();
+
+	// Returns the x or y coordinates of the points of a template. In the interleaved layout, they are gathered into buffer, which must hold pointCount values.
+	const float* LoadX(int index, float* buffer) const;
+	const float* LoadY(int index, float* buffer) const;
+
+	// Runs the golden-section search for the TEMPLATE_LANES templates of a block in lockstep, and returns the distance at the best angle of each one.
+	void GetDistancesToBlock(int block, const float* candidateX, const float* candidateY, const Vector2& centroid, float* distances) const;
+
+	// Finds the distance between the candidate and a template at the best angle between angleAlpha and angleBeta by rotating the candidate around its centroid.
+	// The rotated candidate is written to rotatedX and rotatedY.
+	float GetDistanceAtBestAngle(const float* templateX, const float* templateY, const float* candidateX, const float* candidateY, const Vector2& centroid, float* rotatedX, float* rotatedY, float angleAlpha, float angleBeta) const;
+
+	// Finds the distance between the candidate and a template at the best angle, using the rotation table. The coordinates of the template are only read by the refinement.
+	float GetDistanceFromRotationTable(int index, const float* templateX, const float* templateY, const float* candidateX, const float* candidateY, const Vector2& centroid, float* rotatedX, float* rotatedY) const;
+
+	int pointCount;
+	int size;
+
+	std::vector<std::string> names;
+	std::vector<StrokeFeatures> features;
+	std::vector<float> xs;
+	std::vector<float> ys;
+
+	AngleSearchMethod angleSearchMethod = AngleSearchMethod::GoldenSection;
+	TemplateLayout layout = TemplateLayout::PerTemplate;
+
+	// The indices of the samples of each name, and the name of each template.
+	std::vector<std::vector<int>> classTemplates;
+	std::vector<int> templateClasses;
+
+	// The index of the medoid of each name, if the class filter is enabled.
+	int classFilterCount = 0;
+	std::vector<int> classMedoids;
+
+	// The range of the features accepted for each name, if the feature cascade is enabled.
+	float featureTolerance = 0.0f;
+	std::vector<StrokeFeatures> classFeatureMinimums;
+	std::vector<StrokeFeatures> classFeatureMaximums;
+
+	// Point j of template i is at interleavedXs[((i / TEMPLATE_LANES) * pointCount + j) * TEMPLATE_LANES + i % TEMPLATE_LANES].
+	// The last block is padded with copies of the last template. In the interleaved layout, xs and ys are empty.
+	std::vector<float> interleavedXs;
+	std::vector<float> interleavedYs;
+
+	float rotationStep = 0.0f;
+	bool refineRotation = true;
+
+	// The points of template i rotated by -angle k start at rotatedXs[(i * rotationCount + k) * pointCount].
+	int rotationCount = 0;
+	std::vector<float> rotationAngles;
+	std::vector<float> rotatedXs;
+	std::vector<float> rotatedYs;
+};
@@ -0,0 +1,123 @@
+#include "TemplateHeader.h"
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+
+namespace
+{
+	// The number of values per line in the arrays.
+	const int VALUES_PER_LINE = 8;
+
+	// Writes a float literal that is read back as the same float. A degenerate stroke (e.g. a horizontal line) may be scaled to infinite or undefined coordinates.
+	void WriteFloat(float value, std::ostream& out)
+	{
+		if (std::isnan(value))
+			out << "std::numeric_limits<float>::quiet_NaN()";
+		else if (std::isinf(value))
+			out << (value < 0.0f ? "-" : "") << "std::numeric_limits<float>::infinity()";
+		else
+			out << value << "f";
+	}
+
+	// Writes a string literal, escaping the quotes and the backslashes.
+	void WriteString(const std::string& value, std::ostream& out)
+	{
+		out << "\"";
+		for (char character : value)
+		{
+			if (character == '"' || character == '\\')
+				out << "\\";
+			out << character;
+		}
+		out << "\"";
+	}
+
+	// Writes the coordinates of every template, one template after the other.
+	void WriteCoordinates(const TemplateBank& bank, const char* arrayName, bool isX, std::ostream& out)
+	{
+		out << "constexpr float " << arrayName << "[EMBEDDED_TEMPLATE_COUNT * EMBEDDED_POINT_COUNT] =" << std::endl;
+		out << "{" << std::endl;
+
+		for (int i = 0; i < bank.GetTemplateCount(); ++i)
+		{
+			const float* coordinates = isX ? bank.GetX(i) : bank.GetY(i);
+
+			out << "\t// " << bank.GetName(i) << std::endl;
+			for (int j = 0; j < bank.GetPointCount(); ++j)
+			{
+				out << (j % VALUES_PER_LINE == 0 ? "\t" : " ");
+				WriteFloat(coordinates[j], out);
+				out << ",";
+
+				if (j % VALUES_PER_LINE == VALUES_PER_LINE - 1 || j == bank.GetPointCount() - 1)
+					out << std::endl;
+			}
+		}
+
+		out << "};" << std::endl;
+		out << std::endl;
+	}
+}
+
+bool WriteTemplateHeader(const TemplateBank& bank, const std::string& sourceFileName, std::ostream& out)
+{
+	const int templateCount = bank.GetTemplateCount();
+
+	if (templateCount == 0)
+	{
+		std::cerr << "Error: Cannot write the template header: There is no template." << std::endl;
+		return false;
+	}
+
+	// showpoint makes every value a floating-point literal, even the integers, so that the f suffix is valid.
+	out << std::showpoint << std::setprecision(std::numeric_limits<float>::max_digits10);
+
+	out << "// " << EMBEDDED_TEMPLATES_FILENAME << std::endl;
+	out << "// Generated from " << sourceFileName << " by GestureRecognizer.exe --generate-header. Do not edit." << std::endl;
+	out << std::endl;
+	out << "#pragma once" << std::endl;
+	out << std::endl;
+	out << "#include <limits>" << std::endl;
+	out << "#include \"Stroke.h\"" << std::endl;
+	out << std::endl;
+
+	out << "constexpr int EMBEDDED_TEMPLATE_COUNT = " << templateCount << ";" << std::endl;
+	out << "constexpr int EMBEDDED_POINT_COUNT = " << bank.GetPointCount() << ";" << std::endl;
+	out << "constexpr int EMBEDDED_SIZE = " << bank.GetSize() << ";" << std::endl;
+	out << std::endl;
+
+	out << "constexpr const char* EMBEDDED_NAMES[EMBEDDED_TEMPLATE_COUNT] =" << std::endl;
+	out << "{" << std::endl;
+	for (int i = 0; i < templateCount; ++i)
+	{
+		out << "\t";
+		WriteString(bank.GetName(i), out);
+		out << "," << std::endl;
+	}
+	out << "};" << std::endl;
+	out << std::endl;
+
+	out << "// The points of template i are EMBEDDED_XS[i * EMBEDDED_POINT_COUNT] to EMBEDDED_XS[(i + 1) * EMBEDDED_POINT_COUNT - 1], and likewise for the y coordinates." << std::endl;
+	WriteCoordinates(bank, "EMBEDDED_XS", true, out);
+	WriteCoordinates(bank, "EMBEDDED_YS", false, out);
+
+	out << "constexpr StrokeFeatures EMBEDDED_FEATURES[EMBEDDED_TEMPLATE_COUNT] =" << std::endl;
+	out << "{" << std::endl;
+	for (int i = 0; i < templateCount; ++i)
+	{
+		const StrokeFeatures& features = bank.GetFeatures(i);
+
+		out << "\t{ {";
+		for (int k = 0; k < (int)StrokeFeature::Count; ++k)
+		{
+			out << " ";
+			WriteFloat(features.values[k], out);
+			out << ",";
+		}
+		out << " } }," << std::endl;
+	}
+	out << "};" << std::endl;
+
+	return true;
+}
@@ -0,0 +1,16 @@
+// TemplateHeader.h
+// Programmer: Khoi Ho
+
+#pragma once
+
+#include <ostream>
+#include <string>
+#include "TemplateBank.h"
+
+// The header written by WriteTemplateHeader, which main.cpp includes when GESTURE_EMBEDDED_TEMPLATES is defined.
+const std::string EMBEDDED_TEMPLATES_FILENAME = "EmbeddedTemplates.h";
+
+// Writes the preprocessed templates of the bank as a C++ header of constexpr arrays in the layout of the bank:
+// EMBEDDED_TEMPLATE_COUNT, EMBEDDED_POINT_COUNT, EMBEDDED_SIZE, EMBEDDED_NAMES, EMBEDDED_XS, EMBEDDED_YS and EMBEDDED_FEATURES, which TemplateBank::Load takes.
+// The coordinates are written with enough digits to be read back exactly. Returns false if the bank is empty.
+bool WriteTemplateHeader(const TemplateBank& bank, const std::string& sourceFileName, std::ostream& out);
@@ -0,0 +1,156 @@
+#include "Tracer.h"
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> Tracer::enabled(false);
+
+namespace
+{
+	// A slot of a ring buffer. The sequence number is odd while the event is being written, so a reader can detect torn events.
+	struct TraceSlot
+	{
+		std::atomic<uint64_t> sequence;
+		TraceEvent event;
+	};
+
+	// The ring buffer of a thread. Only the owning thread writes to it.
+	struct ThreadBuffer
+	{
+		int threadId;
+		std::atomic<uint64_t> head;
+		TraceSlot slots[Tracer::RING_BUFFER_SIZE];
+	};
+
+	// The buffers of all threads that have recorded an event. The mutex is only locked when a thread records its first event and when the trace is written.
+	std::mutex bufferListMutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> bufferList;
+
+	ThreadBuffer& GetThreadBuffer()
+	{
+		thread_local ThreadBuffer* threadBuffer = nullptr;
+
+		if (threadBuffer == nullptr)
+		{
+			std::unique_ptr<ThreadBuffer> newBuffer(new ThreadBuffer());
+			newBuffer->head.store(0, std::memory_order_relaxed);
+			for (TraceSlot& slot : newBuffer->slots)
+				slot.sequence.store(0, std::memory_order_relaxed);
+
+			std::lock_guard<std::mutex> lock(bufferListMutex);
+			newBuffer->threadId = (int)bufferList.size() + 1;
+			threadBuffer = newBuffer.get();
+			bufferList.push_back(std::move(newBuffer));
+		}
+
+		return *threadBuffer;
+	}
+
+	// Writes a string as a JSON string literal.
+	void WriteJsonString(std::ostream& out, const char* text)
+	{
+		out << '"';
+		for (const char* c = text; *c != '\0'; ++c)
+		{
+			if (*c == '"' || *c == '\\')
+				out << '\\';
+			out << *c;
+		}
+		out << '"';
+	}
+}
+
+void Tracer::SetEnabled(bool enabled)
+{
+	Tracer::enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool Tracer::IsEnabled()
+{
+	return enabled.load(std::memory_order_relaxed);
+}
+
+uint64_t Tracer::GetTime()
+{
+	static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void Tracer::Record(const char* name, const char* category, uint64_t start, uint64_t duration)
+{
+	ThreadBuffer& buffer = GetThreadBuffer();
+
+	const uint64_t index = buffer.head.load(std::memory_order_relaxed);
+	TraceSlot& slot = buffer.slots[index % RING_BUFFER_SIZE];
+
+	slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	slot.event.name = name;
+	slot.event.category = category;
+	slot.event.start = start;
+	slot.event.duration = duration;
+
+	slot.sequence.store(2 * index + 2, std::memory_order_release);
+	buffer.head.store(index + 1, std::memory_order_release);
+}
+
+bool Tracer::WriteToFile(const std::string& fileName)
+{
+	std::fstream outputFile(fileName, std::ofstream::out | std::ofstream::trunc);
+	if (!outputFile)
+	{
+		std::cerr << "Error: Cannot open the file " << fileName << "." << std::endl;
+		return false;
+	}
+
+	outputFile << std::fixed << std::setprecision(3);
+	outputFile << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+	bool isFirstEvent = true;
+
+	std::lock_guard<std::mutex> lock(bufferListMutex);
+	for (const std::unique_ptr<ThreadBuffer>& buffer : bufferList)
+	{
+		const uint64_t head = buffer->head.load(std::memory_order_acquire);
+		const uint64_t first = head > RING_BUFFER_SIZE ? head - RING_BUFFER_SIZE : 0;
+
+		for (uint64_t i = first; i < head; ++i)
+		{
+			const TraceSlot& slot = buffer->slots[i % RING_BUFFER_SIZE];
+
+			// Skip the events that are overwritten while being read.
+			const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+			if (sequence != 2 * i + 2)
+				continue;
+
+			TraceEvent event = slot.event;
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (slot.sequence.load(std::memory_order_relaxed) != sequence)
+				continue;
+
+			if (!isFirstEvent)
+				outputFile << ",";
+			isFirstEvent = false;
+
+			// Chrome expects the timestamps in microseconds.
+			outputFile << "\n{\"name\":";
+			WriteJsonString(outputFile, event.name);
+			outputFile << ",\"cat\":";
+			WriteJsonString(outputFile, event.category);
+			outputFile << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId
+				<< ",\"ts\":" << event.start / 1000.0
+				<< ",\"dur\":" << event.duration / 1000.0
+				<< "}";
+		}
+	}
+
+	outputFile << "\n]}" << std::endl;
+
+	outputFile.close();
+	return true;
+}
@@ -0,0 +1,76 @@
+// Tracer.h
+// Programmer: Khoi Ho
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// An event with a start time and a duration, shown as a slice in chrome://tracing or Perfetto.
+struct TraceEvent
+{
+	// Must point to a string that lives until the trace is written (e.g. a string literal).
+	const char* name;
+	const char* category;
+
+	// Time since the tracer was started in nanoseconds.
+	uint64_t start;
+	uint64_t duration;
+};
+
+// Records trace events into per-thread ring buffers and writes them in the Chrome trace event format.
+// Recording never takes a lock, so the tracer can stay enabled while the program is running. When a ring buffer is full, the oldest events are overwritten.
+// The instrumentation is only compiled in when GESTURE_TRACING is defined. Otherwise, TRACE_SCOPE expands to nothing.
+class Tracer
+{
+public:
+	// The number of events kept for each thread.
+	static const int RING_BUFFER_SIZE = 1 << 12;
+
+	// Starts or stops recording events.
+	static void SetEnabled(bool enabled);
+	static bool IsEnabled();
+
+	// Returns the time since the tracer was started in nanoseconds.
+	static uint64_t GetTime();
+
+	// Adds an event to the ring buffer of the calling thread.
+	static void Record(const char* name, const char* category, uint64_t start, uint64_t duration);
+
+	// Writes the events of all threads to a JSON file. Return true if the file is successfully saved.
+	static bool WriteToFile(const std::string& fileName);
+
+private:
+	static std::atomic<bool> enabled;
+};
+
+// Records an event that lasts from its construction to its destruction.
+class TraceScope
+{
+public:
+	TraceScope(const char* name, const char* category) : name(name), category(category), start(0)
+	{
+		if (Tracer::IsEnabled())
+			start = Tracer::GetTime() + 1;
+	}
+
+	~TraceScope()
+	{
+		// The start time is offset by 1 so that 0 means the tracer was disabled.
+		if (start != 0)
+			Tracer::Record(name, category, start - 1, Tracer::GetTime() - (start - 1));
+	}
+
+private:
+	const char* name;
+	const char* category;
+	uint64_t start;
+};
+
+#ifdef GESTURE_TRACING
+#define TRACE_SCOPE(name, category) TraceScope traceScope(name, category)
+#else
+#define TRACE_SCOPE(name, category)
+#endif
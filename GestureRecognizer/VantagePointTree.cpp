@@ -0,0 +1,312 @@
+#include "VantagePointTree.h"
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include "Kernels.h"
+#include "PerfCounters.h"
+#include "Profiler.h"
+#include "Tracer.h"
+#include "WorkCounters.h"
+
+VantagePointTree::VantagePointTree(int pointCount, int size):pointCount(pointCount), size(size) {}
+
+void VantagePointTree::Build(const TemplateBank& bank)
+{
+	if (bank.GetPointCount() != pointCount || bank.GetSize() != size)
+		throw std::exception("Cannot build the tree: The templates must have the same number of points and size as the tree.");
+
+	names.clear();
+	xs.clear();
+	ys.clear();
+	isRemoved.clear();
+	templateNodes.clear();
+	removedCount = 0;
+
+	const int templateCount = bank.GetTemplateCount();
+	names.reserve(templateCount);
+	xs.reserve(templateCount * pointCount);
+	ys.reserve(templateCount * pointCount);
+
+	for (int i = 0; i < templateCount; ++i)
+		AddTemplate(bank.GetName(i), bank.GetX(i), bank.GetY(i));
+
+	Rebuild();
+}
+
+int VantagePointTree::Insert(const Stroke& stroke)
+{
+	if (stroke.GetPointCount() != pointCount)
+		throw std::exception("Cannot insert the stroke: The stroke must be resampled into as many points as the tree.");
+
+	std::vector<float> x(pointCount);
+	std::vector<float> y(pointCount);
+	for (int i = 0; i < pointCount; ++i)
+	{
+		x[i] = stroke.GetPoint(i).x;
+		y[i] = stroke.GetPoint(i).y;
+	}
+
+	const int index = AddTemplate(std::string(stroke.name.begin(), stroke.name.end()), x.data(), y.data());
+
+	Node newNode;
+	newNode.index = index;
+	newNode.radius = 0.0f;
+	newNode.inside = -1;
+	newNode.outside = -1;
+	newNode.parent = -1;
+	newNode.templateCount = 1;
+
+	if (root < 0)
+	{
+		root = nodes.size();
+		templateNodes[index] = root;
+		nodes.push_back(newNode);
+		return index;
+	}
+
+	// Walk down to an empty child. A node without children takes the distance to its first child as its radius.
+	int node = root;
+	while (true)
+	{
+		++nodes[node].templateCount;
+
+		const float distance = GetPathDistance(x.data(), y.data(), GetX(nodes[node].index), GetY(nodes[node].index), pointCount);
+
+		if (nodes[node].inside < 0 && nodes[node].outside < 0)
+			nodes[node].radius = distance;
+
+		int& child = distance < nodes[node].radius ? nodes[node].inside : nodes[node].outside;
+		if (child < 0)
+		{
+			child = nodes.size();
+			newNode.parent = node;
+			templateNodes[index] = child;
+			nodes.push_back(newNode);
+			return index;
+		}
+
+		node = child;
+	}
+}
+
+int VantagePointTree::Remove(const std::string& name)
+{
+	int count = 0;
+
+	for (int i = 0; i < GetTemplateCount(); ++i)
+	{
+		if (!isRemoved[i] && names[i] == name)
+		{
+			isRemoved[i] = true;
+			++removedCount;
+			++count;
+
+			// The template stays in the tree, but no longer counts in the subtrees that contain it.
+			for (int node = templateNodes[i]; node >= 0; node = nodes[node].parent)
+				--nodes[node].templateCount;
+		}
+	}
+
+	if (removedCount > GetTemplateCount() / 2)
+	{
+		// Compact the templates, then build a new tree.
+		int liveCount = 0;
+		for (int i = 0; i < GetTemplateCount(); ++i)
+		{
+			if (isRemoved[i])
+				continue;
+
+			// The templates before the first removed one stay in place. Moving a string onto itself may empty it.
+			if (liveCount != i)
+			{
+				names[liveCount] = std::move(names[i]);
+				std::copy(xs.begin() + i * pointCount, xs.begin() + (i + 1) * pointCount, xs.begin() + liveCount * pointCount);
+				std::copy(ys.begin() + i * pointCount, ys.begin() + (i + 1) * pointCount, ys.begin() + liveCount * pointCount);
+			}
+			++liveCount;
+		}
+
+		names.resize(liveCount);
+		xs.resize(liveCount * pointCount);
+		ys.resize(liveCount * pointCount);
+		isRemoved.assign(liveCount, false);
+		templateNodes.assign(liveCount, -1);
+		removedCount = 0;
+
+		Rebuild();
+	}
+
+	return count;
+}
+
+int VantagePointTree::GetTemplateCount() const
+{
+	return names.size();
+}
+
+int VantagePointTree::GetPointCount() const
+{
+	return pointCount;
+}
+
+int VantagePointTree::GetSize() const
+{
+	return size;
+}
+
+const std::string& VantagePointTree::GetName(int index) const
+{
+	return names[index];
+}
+
+size_t VantagePointTree::GetMemoryUsage() const
+{
+	return (xs.size() + ys.size()) * sizeof(float) + nodes.size() * sizeof(Node);
+}
+
+int VantagePointTree::AddTemplate(const std::string& name, const float* x, const float* y)
+{
+	names.push_back(name);
+	xs.insert(xs.end(), x, x + pointCount);
+	ys.insert(ys.end(), y, y + pointCount);
+	isRemoved.push_back(false);
+	templateNodes.push_back(-1);
+
+	return names.size() - 1;
+}
+
+int VantagePointTree::BuildSubtree(std::vector<int>& indices, int begin, int end, int parent, Random& random)
+{
+	if (begin == end)
+		return -1;
+
+	// Take a random vantage point, then split the other templates at the median distance to it.
+	std::swap(indices[begin], indices[random.Integer(begin, end - 1)]);
+	const int vantageIndex = indices[begin];
+
+	std::vector<std::pair<float, int>> distances;
+	distances.reserve(end - begin - 1);
+	for (int i = begin + 1; i < end; ++i)
+		distances.push_back(std::make_pair(GetPathDistance(GetX(vantageIndex), GetY(vantageIndex), GetX(indices[i]), GetY(indices[i]), pointCount), indices[i]));
+
+	float radius = 0.0f;
+	if (!distances.empty())
+	{
+		std::nth_element(distances.begin(), distances.begin() + distances.size() / 2, distances.end());
+		radius = distances[distances.size() / 2].first;
+	}
+
+	// The templates at the radius go outside, as in Insert.
+	const int insideCount = std::partition(distances.begin(), distances.end(), [radius](const std::pair<float, int>& distance) { return distance.first < radius; }) - distances.begin();
+	for (int i = 0; i < (int)distances.size(); ++i)
+		indices[begin + 1 + i] = distances[i].second;
+
+	const int node = nodes.size();
+	nodes.push_back(Node());
+	nodes[node].index = vantageIndex;
+	nodes[node].radius = radius;
+	nodes[node].parent = parent;
+	nodes[node].templateCount = end - begin;
+	templateNodes[vantageIndex] = node;
+
+	const int inside = BuildSubtree(indices, begin + 1, begin + 1 + insideCount, node, random);
+	const int outside = BuildSubtree(indices, begin + 1 + insideCount, end, node, random);
+	nodes[node].inside = inside;
+	nodes[node].outside = outside;
+
+	return node;
+}
+
+void VantagePointTree::Rebuild()
+{
+	TRACE_SCOPE("BuildVantagePointTree", "preprocessing");
+
+	nodes.clear();
+	nodes.reserve(GetTemplateCount());
+
+	std::vector<int> indices(GetTemplateCount());
+	for (int i = 0; i < GetTemplateCount(); ++i)
+		indices[i] = i;
+
+	// Use the same vantage points every time, so that the tree does not change between runs.
+	Random random;
+	random.Seed(GetTemplateCount());
+
+	root = BuildSubtree(indices, 0, indices.size(), -1, random);
+}
+
+void VantagePointTree::Search(int node, const float* x, const float* y, int& matchingIndex, float& bestDistance) const
+{
+	WorkCounters& workCounters = WorkCounters::GetThreadCounters();
+	++workCounters.distanceEvaluations;
+	workCounters.pointsTouched += 2 * pointCount;
+
+	const Node& currentNode = nodes[node];
+	const float distance = GetPathDistance(x, y, GetX(currentNode.index), GetY(currentNode.index), pointCount);
+
+	if (!isRemoved[currentNode.index] && distance < bestDistance)
+	{
+		bestDistance = distance;
+		matchingIndex = currentNode.index;
+	}
+
+	// Search the side of the candidate first, so that the other side is more likely to be pruned.
+	// A closer template can only be inside if distance - bestDistance < radius, and outside if distance + bestDistance >= radius.
+	const bool isInside = distance < currentNode.radius;
+	const int children[2] = { isInside ? currentNode.inside : currentNode.outside, isInside ? currentNode.outside : currentNode.inside };
+
+	for (int i = 0; i < 2; ++i)
+	{
+		const int child = children[i];
+		if (child < 0)
+			continue;
+
+		const bool canContainCloser = child == currentNode.inside ? distance - bestDistance < currentNode.radius : distance + bestDistance >= currentNode.radius;
+		if (canContainCloser)
+			Search(child, x, y, matchingIndex, bestDistance);
+		else
+			workCounters.templatesSkipped += nodes[child].templateCount;
+	}
+}
+
+const float* VantagePointTree::GetX(int index) const
+{
+	return xs.data() + index * pointCount;
+}
+
+const float* VantagePointTree::GetY(int index) const
+{
+	return ys.data() + index * pointCount;
+}
+
+void VantagePointTree::Recognize(const Stroke& candidate, int& matchingIndex, float& score, std::pmr::memory_resource* resource) const
+{
+	PROFILE_STAGE(ProfileStage::Recognize);
+	TRACE_SCOPE("Recognize", "recognition");
+	PERF_SCOPE(PerfStage::Recognize);
+
+	if (candidate.GetPointCount() != pointCount)
+		throw std::exception("Cannot recognize the stroke: The stroke must be resampled into as many points as the templates.");
+
+	// Remember the work done so far, so that the work of this recognition can be measured.
+	WorkCounters& workCounters = WorkCounters::GetThreadCounters();
+	const WorkCounters workCountersBefore = workCounters;
+
+	std::pmr::vector<float> candidateX(pointCount, resource);
+	std::pmr::vector<float> candidateY(pointCount, resource);
+	for (int i = 0; i < pointCount; ++i)
+	{
+		candidateX[i] = candidate.GetPoint(i).x;
+		candidateY[i] = candidate.GetPoint(i).y;
+	}
+
+	float bestDistance = std::numeric_limits<float>::infinity();
+	matchingIndex = -1;
+
+	if (root >= 0)
+		Search(root, candidateX.data(), candidateY.data(), matchingIndex, bestDistance);
+
+	score = 1.0f - bestDistance / (0.5f * std::sqrt((float)(size * size + size * size)));
+
+	WorkCounters::AddRecognition(workCounters - workCountersBefore);
+}
@@ -0,0 +1,89 @@
+// VantagePointTree.h
+// Programmer: Khoi Ho
+
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+#include <vector>
+#include "Random.h"
+#include "Stroke.h"
+#include "TemplateBank.h"
+
+// A metric tree over preprocessed templates, which finds the nearest template without comparing the candidate with every template.
+// The average distance between respective points (GetPathDistance) is a metric, so the triangle inequality tells which subtrees cannot contain a closer template.
+// The candidate is compared at its indicative angle only, without the search for the best angle.
+class VantagePointTree
+{
+public:
+	// The templates must be resampled into pointCount points and scaled to a square of the specified size.
+	VantagePointTree(int pointCount = 64, int size = 250);
+
+	// Replaces the templates with the templates of the bank and builds a balanced tree.
+	void Build(const TemplateBank& bank);
+
+	// Adds a preprocessed stroke below the existing templates and returns its index.
+	int Insert(const Stroke& stroke);
+
+	// Removes the templates with the name and returns how many were removed.
+	// The templates are only marked as removed, until more than half of them are and the tree is rebuilt, which changes the indices.
+	int Remove(const std::string& name);
+
+	// Returns the number of templates, including the removed ones that are still in the tree.
+	int GetTemplateCount() const;
+	int GetPointCount() const;
+	int GetSize() const;
+
+	// Returns the name of a template.
+	const std::string& GetName(int index) const;
+
+	// Returns the number of bytes used by the coordinates and the nodes.
+	size_t GetMemoryUsage() const;
+
+	// Finds the template nearest to the preprocessed candidate and returns its index (or -1 if there is none) and the score.
+	// The temporary buffers are allocated from the memory resource.
+	void Recognize(const Stroke& candidate, int& matchingIndex, float& score, std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const;
+
+private:
+	// The templates closer to the template of the node than the radius are below the inside child, the other ones are below the outside child.
+	struct Node
+	{
+		int index;
+		float radius;
+		int inside;
+		int outside;
+		int parent;
+
+		// The number of templates in the subtree that are not removed.
+		int templateCount;
+	};
+
+	int AddTemplate(const std::string& name, const float* x, const float* y);
+
+	// Builds a balanced subtree from the templates and returns its node.
+	int BuildSubtree(std::vector<int>& indices, int begin, int end, int parent, Random& random);
+
+	// Rebuilds the tree without the removed templates.
+	void Rebuild();
+
+	void Search(int node, const float* x, const float* y, int& matchingIndex, float& bestDistance) const;
+
+	const float* GetX(int index) const;
+	const float* GetY(int index) const;
+
+	int pointCount;
+	int size;
+
+	std::vector<std::string> names;
+	std::vector<float> xs;
+	std::vector<float> ys;
+	std::vector<bool> isRemoved;
+	int removedCount = 0;
+
+	std::vector<Node> nodes;
+	int root = -1;
+
+	// The node of each template.
+	std::vector<int> templateNodes;
+};
@@ -0,0 +1,107 @@
+#include "WorkCounters.h"
+#include <atomic>
+#include <iomanip>
+
+namespace
+{
+	thread_local WorkCounters threadCounters;
+	thread_local WorkCounters lastRecognitionCounters;
+
+	std::atomic<uint64_t> totalDistanceEvaluations(0);
+	std::atomic<uint64_t> totalAngleSearchIterations(0);
+	std::atomic<uint64_t> totalRotations(0);
+	std::atomic<uint64_t> totalPointsTouched(0);
+	std::atomic<uint64_t> totalTemplatesSkipped(0);
+	std::atomic<uint64_t> totalRecognitions(0);
+}
+
+WorkCounters& WorkCounters::operator+=(const WorkCounters& other)
+{
+	distanceEvaluations += other.distanceEvaluations;
+	angleSearchIterations += other.angleSearchIterations;
+	rotations += other.rotations;
+	pointsTouched += other.pointsTouched;
+	templatesSkipped += other.templatesSkipped;
+
+	return *this;
+}
+
+WorkCounters WorkCounters::operator-(const WorkCounters& other) const
+{
+	WorkCounters difference;
+	difference.distanceEvaluations = distanceEvaluations - other.distanceEvaluations;
+	difference.angleSearchIterations = angleSearchIterations - other.angleSearchIterations;
+	difference.rotations = rotations - other.rotations;
+	difference.pointsTouched = pointsTouched - other.pointsTouched;
+	difference.templatesSkipped = templatesSkipped - other.templatesSkipped;
+
+	return difference;
+}
+
+void WorkCounters::Print(std::ostream& out, uint64_t recognitionCount) const
+{
+	if (recognitionCount == 0)
+		recognitionCount = 1;
+
+	std::ios::fmtflags flags = out.flags();
+	std::streamsize precision = out.precision();
+
+	out << std::fixed << std::setprecision(1);
+	out << "\tDistance evaluations:    " << (double)distanceEvaluations / recognitionCount << std::endl;
+	out << "\tAngle search iterations: " << (double)angleSearchIterations / recognitionCount << std::endl;
+	out << "\tRotations:               " << (double)rotations / recognitionCount << std::endl;
+	out << "\tPoints touched:          " << (double)pointsTouched / recognitionCount << std::endl;
+	out << "\tTemplates skipped:       " << (double)templatesSkipped / recognitionCount << std::endl;
+
+	out.flags(flags);
+	out.precision(precision);
+}
+
+WorkCounters& WorkCounters::GetThreadCounters()
+{
+	return threadCounters;
+}
+
+WorkCounters WorkCounters::GetLastRecognition()
+{
+	return lastRecognitionCounters;
+}
+
+WorkCounters WorkCounters::GetTotal()
+{
+	WorkCounters total;
+	total.distanceEvaluations = totalDistanceEvaluations.load(std::memory_order_relaxed);
+	total.angleSearchIterations = totalAngleSearchIterations.load(std::memory_order_relaxed);
+	total.rotations = totalRotations.load(std::memory_order_relaxed);
+	total.pointsTouched = totalPointsTouched.load(std::memory_order_relaxed);
+	total.templatesSkipped = totalTemplatesSkipped.load(std::memory_order_relaxed);
+
+	return total;
+}
+
+uint64_t WorkCounters::GetRecognitionCount()
+{
+	return totalRecognitions.load(std::memory_order_relaxed);
+}
+
+void WorkCounters::ResetTotal()
+{
+	totalDistanceEvaluations.store(0, std::memory_order_relaxed);
+	totalAngleSearchIterations.store(0, std::memory_order_relaxed);
+	totalRotations.store(0, std::memory_order_relaxed);
+	totalPointsTouched.store(0, std::memory_order_relaxed);
+	totalTemplatesSkipped.store(0, std::memory_order_relaxed);
+	totalRecognitions.store(0, std::memory_order_relaxed);
+}
+
+void WorkCounters::AddRecognition(const WorkCounters& recognitionCounters)
+{
+	lastRecognitionCounters = recognitionCounters;
+
+	totalDistanceEvaluations.fetch_add(recognitionCounters.distanceEvaluations, std::memory_order_relaxed);
+	totalAngleSearchIterations.fetch_add(recognitionCounters.angleSearchIterations, std::memory_order_relaxed);
+	totalRotations.fetch_add(recognitionCounters.rotations, std::memory_order_relaxed);
+	totalPointsTouched.fetch_add(recognitionCounters.pointsTouched, std::memory_order_relaxed);
+	totalTemplatesSkipped.fetch_add(recognitionCounters.templatesSkipped, std::memory_order_relaxed);
+	totalRecognitions.fetch_add(1, std::memory_order_relaxed);
+}
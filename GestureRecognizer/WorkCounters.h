@@ -0,0 +1,50 @@
+// WorkCounters.h
+// Programmer: Khoi Ho
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+
+// Counts the work done by the recognition, so that algorithmic changes can be compared by work done and not only by wall time.
+struct WorkCounters
+{
+	// The number of calls to GetDistanceAtAngle.
+	uint64_t distanceEvaluations = 0;
+
+	// The number of iterations of the golden-section search.
+	uint64_t angleSearchIterations = 0;
+
+	// The number of calls to RotateBy.
+	uint64_t rotations = 0;
+
+	// The number of points read by the transforms and the distance computations.
+	uint64_t pointsTouched = 0;
+
+	// The number of templates ruled out without searching for the best angle.
+	uint64_t templatesSkipped = 0;
+
+	WorkCounters& operator+= (const WorkCounters& other);
+	WorkCounters operator- (const WorkCounters& other) const;
+
+	// Writes the counters, divided by the number of recognitions.
+	void Print(std::ostream& out, uint64_t recognitionCount = 1) const;
+
+	// Returns the counters of the calling thread. The recognition code adds its work to them.
+	static WorkCounters& GetThreadCounters();
+
+	// Returns the work done by the last recognition on the calling thread.
+	static WorkCounters GetLastRecognition();
+
+	// Returns the work done by all recognitions on all threads since the last reset.
+	static WorkCounters GetTotal();
+
+	// Returns the number of recognitions on all threads since the last reset.
+	static uint64_t GetRecognitionCount();
+
+	// Clears the totals.
+	static void ResetTotal();
+
+	// Stores the work done by a recognition that has just finished on the calling thread.
+	static void AddRecognition(const WorkCounters& recognitionCounters);
+};
@@ -4,9 +4,11 @@
 // Fix error C2338.
 #define WINDOWS_IGNORE_PACKING_MISMATCH
 
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <memory_resource>
 #include <vector>
 #include <sstream>
 #include "SDL_gpu.h"
@@ -15,6 +17,19 @@
 #include "Random.h"
 #include "Vector2.h"
 #include "Stroke.h"
+#include "RecognitionWorker.h"
+#include "SharedTemplateBank.h"
+#include "TemplateBank.h"
+#include "Benchmark.h"
+#include "Condensation.h"
+#include "TemplateHeader.h"
+#include "PerfCounters.h"
+#include "Profiler.h"
+#include "Tracer.h"
+
+#ifdef GESTURE_EMBEDDED_TEMPLATES
+#include "EmbeddedTemplates.h"
+#endif
 
 // Open the stroke file and read the strokes.
 void OpenStrokeFile(const std::string& fileName, std::vector<Stroke>& strokes);
@@ -22,6 +37,9 @@ void OpenStrokeFile(const std::string& fileName, std::vector<Stroke>& strokes);
 // Save the strokes to a file. Return true is the file is successfully saved.
 bool SaveStrokesToFile(const std::string& fileName, const std::vector<Stroke>& strokes);
 
+// Copy the preprocessed templates of the bank into strokes, translated to the center of the screen so that they can be viewed.
+void CopyTemplatesToStrokes(const TemplateBank& templateBank, const Vector2& center, std::vector<Stroke>& strokes);
+
 // Switch from main window to console window. Need the path of the executable.
 void SwitchToConsoleWindow(const char* programPath);
 
@@ -36,6 +54,62 @@ int main(int argc, char* argv[])
 	const char* FONT_FILENAME = "FreeSans.ttf";
 	const int FONT_SIZE = 14;
 	const std::string STROKE_FILENAME = "mystrokes.txt";
+	const std::string TRACE_FILENAME = "trace.json";
+
+#ifdef GESTURE_TRACING
+	Tracer::SetEnabled(true);
+#endif
+
+	// Run the benchmark instead of opening the window: GestureRecognizer.exe --benchmark [samples per stroke]
+	if (argc > 1 && std::string(argv[1]) == "--benchmark")
+	{
+		std::vector<Stroke> strokes;
+		OpenStrokeFile(STROKE_FILENAME, strokes);
+		return RunBenchmark(strokes, argc > 2 ? std::atoi(argv[2]) : 10, std::cout);
+	}
+
+	// Remove the templates that do not change the recognition and save the others: GestureRecognizer.exe --condense <input file> <output file>
+	if (argc > 1 && std::string(argv[1]) == "--condense")
+	{
+		if (argc < 4)
+		{
+			std::cerr << "Usage: " << argv[0] << " --condense <input file> <output file>" << std::endl;
+			return 1;
+		}
+
+		std::vector<Stroke> strokes;
+		OpenStrokeFile(argv[2], strokes);
+
+		std::vector<Stroke> condensedStrokes = CondenseStrokes(strokes, std::cout);
+		return SaveStrokesToFile(argv[3], condensedStrokes) ? 0 : 1;
+	}
+
+	// Preprocess the templates and write them as a header, which is compiled into the program with GESTURE_EMBEDDED_TEMPLATES:
+	// GestureRecognizer.exe --generate-header <input file> [output header]
+	if (argc > 1 && std::string(argv[1]) == "--generate-header")
+	{
+		if (argc < 3)
+		{
+			std::cerr << "Usage: " << argv[0] << " --generate-header <input file> [output header]" << std::endl;
+			return 1;
+		}
+
+		std::vector<Stroke> strokes;
+		OpenStrokeFile(argv[2], strokes);
+
+		TemplateBank templateBank;
+		templateBank.Build(strokes);
+
+		const std::string headerFileName = argc > 3 ? argv[3] : EMBEDDED_TEMPLATES_FILENAME;
+		std::ofstream headerFile(headerFileName, std::ofstream::out | std::ofstream::trunc);
+		if (!headerFile)
+		{
+			std::cerr << "Error: Cannot open the file " << headerFileName << "." << std::endl;
+			return 1;
+		}
+
+		return WriteTemplateHeader(templateBank, argv[2], headerFile) ? 0 : 1;
+	}
 
 	// Initialize SDL_GPU.
 	GPU_Target* screen = GPU_Init(SCREEN_WIDTH, SCREEN_HEIGHT, GPU_DEFAULT_INIT_FLAGS);
@@ -56,9 +130,34 @@ int main(int argc, char* argv[])
 
 	Stroke drawnStroke;
 
+#ifdef GESTURE_EMBEDDED_TEMPLATES
+	// The templates are compiled into the program, so the stroke file is neither read nor preprocessed.
+	// The strokes are copies of the preprocessed templates, which can be viewed but not saved or deleted:
+	// rebuilding the bank from them would preprocess them twice, and saving them would replace the raw strokes of the stroke file.
+	SharedTemplateBank templateBank(EMBEDDED_POINT_COUNT, EMBEDDED_SIZE);
+	templateBank.Update([](TemplateBank& bank)
+	{
+		bank.Load(EMBEDDED_TEMPLATE_COUNT, EMBEDDED_NAMES, EMBEDDED_XS, EMBEDDED_YS, EMBEDDED_FEATURES);
+	});
+
+	std::vector<Stroke> strokes;
+	CopyTemplatesToStrokes(*templateBank.GetSnapshot(), Vector2(SCREEN_HEIGHT / 2, SCREEN_HEIGHT / 2), strokes);
+#else
 	std::vector<Stroke> strokes;
 	OpenStrokeFile(STROKE_FILENAME, strokes);
 
+	// Preprocess the saved strokes once, instead of every time a stroke is recognized.
+	// The strokes are only used by this thread. The recognition reads a snapshot of the templates, which saving and deleting replace without waiting for it.
+	SharedTemplateBank templateBank;
+	templateBank.Build(strokes);
+#endif
+
+	// Recognize the strokes on another thread, so that the window keeps responding whatever the number of templates.
+	RecognitionWorker recognitionWorker(templateBank);
+
+	// The result of the last recognition, displayed in the window.
+	std::string recognitionText;
+
 	SDL_Event event;
 	bool done = false;
 	while (!done)
@@ -73,7 +172,7 @@ int main(int argc, char* argv[])
 			{
 				if (event.button.button == SDL_BUTTON_LEFT)
 				{
-					drawnStroke.points.clear();
+					drawnStroke.ClearPoints();
 					isDrawing = true;
 				}
 			}
@@ -97,10 +196,13 @@ int main(int argc, char* argv[])
 					// Press S to save the stroke.
 					if (event.key.keysym.sym == SDLK_s)
 					{
+#ifdef GESTURE_EMBEDDED_TEMPLATES
+						std::cout << "Cannot save the stroke: The templates are compiled into the program." << std::endl;
+#else
 						SwitchToConsoleWindow(argv[0]);
 
 						// Cannot save the drawn stroke if it is too short.
-						if (drawnStroke.points.size() < 10)
+						if (drawnStroke.GetPointCount() < 10)
 							std::cout << "Cannot save the stroke: The stroke is too short." << std::endl;
 
 						else
@@ -129,6 +231,9 @@ int main(int argc, char* argv[])
 							// Sort the strokes.
 							sort(strokes.begin(), strokes.end());
 
+							// Update the templates.
+							templateBank.Build(strokes);
+
 							// Save the strokes.
 							bool canSave = SaveStrokesToFile("mystrokes.txt", strokes);
 
@@ -137,56 +242,30 @@ int main(int argc, char* argv[])
 						}
 
 						SwitchToMainWindow(SDL_GetWindowFromID(screen->context->windowID));
+#endif
 					}
 
 					// Press C to clear the drawn stroke.
 					if (event.key.keysym.sym == SDLK_c)
 					{
-						drawnStroke.points.clear();
+						drawnStroke.ClearPoints();
 					}
 
 					// Press R to recognize the drawn stroke.
 					if (event.key.keysym.sym == SDLK_r)
 					{
 						// Cannot recognize the drawn stroke if it is too short.
-						if (drawnStroke.points.size() < 10)
+						if (drawnStroke.GetPointCount() < 10)
 							std::cout << "The stroke is too short." << std::endl;
 
 						else
 						{
-							if (strokes.size() == 0)
+							if (templateBank.GetSnapshot()->GetTemplateCount() == 0)
 								std::cout << "There is no saved stroke." << std::endl;
 
-							else
-							{
-								// Process the drawn stroke.
-								Stroke drawnStrokeCopy = drawnStroke;
-								drawnStrokeCopy = drawnStrokeCopy.Resample();
-								drawnStrokeCopy = drawnStrokeCopy.RotateBy(-drawnStrokeCopy.GetIndicativeAngle());
-								drawnStrokeCopy = drawnStrokeCopy.ScaleTo();
-								drawnStrokeCopy = drawnStrokeCopy.TranslateTo();
-
-								// Process the saved strokes.
-								std::vector<Stroke> strokesCopy(strokes);
-								for (Stroke& stroke : strokesCopy)
-								{
-									stroke = stroke.Resample();
-									stroke = stroke.RotateBy(-stroke.GetIndicativeAngle());
-									stroke = stroke.ScaleTo();
-									stroke = stroke.TranslateTo();
-								}
-
-								// Recognize the stroke.
-								Stroke matchingStroke;
-								float score;
-								drawnStrokeCopy.Recognize(strokesCopy, 250, matchingStroke, score);
-
-								// Display the matching stroke and the score.
-								std::stringstream matchingStrokeSS;
-								matchingStrokeSS << std::fixed << std::setprecision(2);
-								matchingStrokeSS << matchingStroke.name << " (Score = " << score << ")" << std::endl;
-								SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_INFORMATION, "Matching Stroke", matchingStrokeSS.str().c_str(), SDL_GetWindowFromID(screen->context->windowID));
-							}
+							// The stroke is preprocessed and recognized on the worker thread. The result is shown when it is ready.
+							else if (!recognitionWorker.Submit(drawnStroke))
+								std::cout << "Cannot recognize the stroke: Too many strokes are waiting for the recognition." << std::endl;
 						}
 					}
 
@@ -225,7 +304,7 @@ int main(int argc, char* argv[])
 						bool strokeFound = false;
 						for (int i = 0; i < strokes.size(); ++i)
 						{
-							if (strokes[i].name == strokeToView)
+							if (strokes[i].name == strokeToView.c_str())
 							{
 								drawnStroke = strokes[i];
 								strokeFound = true;
@@ -244,6 +323,9 @@ int main(int argc, char* argv[])
 					// Press D to delete a save stroke.
 					if (event.key.keysym.sym == SDLK_d)
 					{
+#ifdef GESTURE_EMBEDDED_TEMPLATES
+						std::cout << "Cannot delete the stroke: The templates are compiled into the program." << std::endl;
+#else
 						SwitchToConsoleWindow(argv[0]);
 
 						system("cls");
@@ -276,29 +358,53 @@ int main(int argc, char* argv[])
 						int i = 0;
 						while (i < strokes.size())
 						{
-							if (strokes[i].name == strokeToDelete)
+							if (strokes[i].name == strokeToDelete.c_str())
 								strokes.erase(strokes.begin() + i);
 							else
 								++i;
 						}
 
+						// Update the templates.
+						templateBank.Build(strokes);
+
 						std::cout << "\"" << strokeToDelete << "\" has been removed from " << STROKE_FILENAME << std::endl;
 
 						SwitchToMainWindow(SDL_GetWindowFromID(screen->context->windowID));
+#endif
 					}
 
 					// Press T to resample the drawn stroke.
 					if (event.key.keysym.sym == SDLK_t)
 					{
 						drawnStroke = drawnStroke.Resample();
-						drawnStroke = drawnStroke.RotateBy(-drawnStroke.GetIndicativeAngle());
-						drawnStroke = drawnStroke.ScaleTo();
-						drawnStroke = drawnStroke.TranslateTo(Vector2(SCREEN_HEIGHT / 2, SCREEN_HEIGHT / 2));
+						drawnStroke = std::move(drawnStroke).RotateBy(-drawnStroke.GetIndicativeAngle());
+						drawnStroke = std::move(drawnStroke).ScaleTo();
+						drawnStroke = std::move(drawnStroke).TranslateTo(Vector2(SCREEN_HEIGHT / 2, SCREEN_HEIGHT / 2));
 					}
 				}
 			}
 		}
 
+		// Display the results of the recognitions that are done, without waiting for the others.
+		RecognitionResult recognitionResult;
+		while (recognitionWorker.TryGetResult(recognitionResult))
+		{
+			std::stringstream matchingStrokeSS;
+			matchingStrokeSS << std::fixed << std::setprecision(2);
+
+			if (recognitionResult.matchingIndex < 0)
+				matchingStrokeSS << "There is no saved stroke.";
+			else
+				matchingStrokeSS << "Matching stroke: " << recognitionResult.name << " (Score = " << recognitionResult.score << ")";
+
+			recognitionText = matchingStrokeSS.str();
+
+#ifdef GESTURE_PROFILING
+			// Display the durations of the stages so far.
+			Profiler::Dump(std::cout);
+#endif
+		}
+
 		// Get the current position of the mouse.
 		SDL_GetMouseState(&mouseX, &mouseY);
 
@@ -308,31 +414,31 @@ int main(int argc, char* argv[])
 			Vector2 mousePosition(mouseX, mouseY);
 
 			// Don't at the latest cursor position to the array if it is not moving.
-			if (drawnStroke.points.size() == 0 || mousePosition != drawnStroke.points[drawnStroke.points.size() - 1])
-				drawnStroke.points.push_back(mousePosition);
+			if (drawnStroke.GetPointCount() == 0 || mousePosition != drawnStroke.GetPoint(drawnStroke.GetPointCount() - 1))
+				drawnStroke.AddPoint(mousePosition);
 		}
 
 		GPU_ClearRGB(screen, 255, 255, 255);
 
 		// Draw the circle marking the first point.
-		if (drawnStroke.points.size() > 0)
-			GPU_Circle(screen, drawnStroke.points[0].x, drawnStroke.points[0].y, 5.0f, GPU_MakeColor(0, 0, 255, 255));
+		if (drawnStroke.GetPointCount() > 0)
+			GPU_Circle(screen, drawnStroke.GetPoint(0).x, drawnStroke.GetPoint(0).y, 5.0f, GPU_MakeColor(0, 0, 255, 255));
 
 		// Draw lines.
 		GPU_SetLineThickness(5.0f);
-		for (int i = 1; i < drawnStroke.points.size(); ++i)
+		for (int i = 1; i < drawnStroke.GetPointCount(); ++i)
 		{
-			Vector2 currentPoint = drawnStroke.points[i-1];
-			Vector2 nextPoint = drawnStroke.points[i];
+			Vector2 currentPoint = drawnStroke.GetPoint(i-1);
+			Vector2 nextPoint = drawnStroke.GetPoint(i);
 			GPU_Line(screen, currentPoint.x, currentPoint.y, nextPoint.x, nextPoint.y, GPU_MakeColor(255, 0, 0, 255));
 		}
 		GPU_SetLineThickness(1.0f);
 
 		// Draw the circle marking the last point.
-		if (drawnStroke.points.size() > 0)
+		if (drawnStroke.GetPointCount() > 0)
 		{
-			const int lastPoint = drawnStroke.points.size() - 1;
-			GPU_Circle(screen, drawnStroke.points[lastPoint].x, drawnStroke.points[lastPoint].y, 5.0f, GPU_MakeColor(0, 122, 0, 255));
+			const int lastPoint = drawnStroke.GetPointCount() - 1;
+			GPU_Circle(screen, drawnStroke.GetPoint(lastPoint).x, drawnStroke.GetPoint(lastPoint).y, 5.0f, GPU_MakeColor(0, 122, 0, 255));
 		}
 
 		font.draw(screen, screen->w - 50.0f, 10.0f, NFont::AlignEnum::RIGHT, 
@@ -345,11 +451,19 @@ int main(int argc, char* argv[])
 		    "T: Resample the stroke\n"
 		);
 
+		font.draw(screen, 10.0f, 10.0f, "%s", recognitionWorker.IsBusy() ? "Recognizing..." : recognitionText.c_str());
+
 		GPU_Flip(screen);
 
 		SDL_Delay(1);
 	}
 
+#ifdef GESTURE_TRACING
+	// Save the trace so that it can be opened in chrome://tracing or Perfetto.
+	if (Tracer::WriteToFile(TRACE_FILENAME))
+		std::cout << "The trace has been saved to " << TRACE_FILENAME << std::endl;
+#endif
+
 	font.free();
 
 	GPU_Quit();
@@ -359,6 +473,8 @@ int main(int argc, char* argv[])
 
 void OpenStrokeFile(const std::string& fileName, std::vector<Stroke>& strokes)
 {
+	TRACE_SCOPE("OpenStrokeFile", "io");
+
 	strokes.clear();
 
 	std::fstream inputFile(fileName, std::ifstream::in);
@@ -397,15 +513,18 @@ void OpenStrokeFile(const std::string& fileName, std::vector<Stroke>& strokes)
 		int numPoints;
 		inputFile >> numPoints;
 
-		strokes[i].points.resize(numPoints);
+		strokes[i].ClearPoints();
+		strokes[i].ReservePoints(numPoints);
 
 		// Read the points.
 		for (int j = 0; j < numPoints; ++j)
 		{
-			inputFile >> strokes[i].points[j].x >> strokes[i].points[j].y;
+			Vector2 point;
+			inputFile >> point.x >> point.y;
+			strokes[i].AddPoint(point);
 		}
 
-		std::cout << "Read the stroke:\t" << strokes[i].name << "\t(Size = " << strokes[i].points.size() << ")" << std::endl;
+		std::cout << "Read the stroke:\t" << strokes[i].name << "\t(Size = " << strokes[i].GetPointCount() << ")" << std::endl;
 	}
 
 	inputFile.close();
@@ -413,6 +532,8 @@ void OpenStrokeFile(const std::string& fileName, std::vector<Stroke>& strokes)
 
 bool SaveStrokesToFile(const std::string& fileName, const std::vector<Stroke>& strokes)
 {
+	TRACE_SCOPE("SaveStrokesToFile", "io");
+
 	std::fstream outputFile(fileName, std::ofstream::out | std::ofstream::trunc);
 	if (!outputFile)
 	{
@@ -431,12 +552,12 @@ bool SaveStrokesToFile(const std::string& fileName, const std::vector<Stroke>& s
 		outputFile << stroke.name << std::endl;
 
 		// Write the number of points.
-		outputFile << stroke.points.size() << std::endl;
+		outputFile << stroke.GetPointCount() << std::endl;
 
 		// Write the points.
-		for (int i = 0; i < stroke.points.size(); ++i)
+		for (int i = 0; i < stroke.GetPointCount(); ++i)
 		{
-			outputFile << stroke.points[i].x << "\t" << stroke.points[i].y << std::endl;
+			outputFile << stroke.GetPoint(i).x << "\t" << stroke.GetPoint(i).y << std::endl;
 		}
 	}
 
@@ -458,4 +579,21 @@ void SwitchToMainWindow(SDL_Window* window)
 	SDL_GetWindowWMInfo(window, &wmInfo);
 
 	::SetForegroundWindow(wmInfo.info.win.window);
-}
\ No newline at end of file
+}
+
+void CopyTemplatesToStrokes(const TemplateBank& templateBank, const Vector2& center, std::vector<Stroke>& strokes)
+{
+	strokes.clear();
+	strokes.reserve(templateBank.GetTemplateCount());
+
+	for (int i = 0; i < templateBank.GetTemplateCount(); ++i)
+	{
+		Stroke stroke(templateBank.GetName(i));
+		stroke.ReservePoints(templateBank.GetPointCount());
+
+		for (int j = 0; j < templateBank.GetPointCount(); ++j)
+			stroke.AddPoint(Vector2(templateBank.GetX(i)[j] + center.x, templateBank.GetY(i)[j] + center.y));
+
+		strokes.push_back(std::move(stroke));
+	}
+}